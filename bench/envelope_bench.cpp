@@ -0,0 +1,86 @@
+//
+// Created by victor on 18/10/26.
+//
+// Compares compute_envelope with the former O(n*w) implementation on synthetic tracks.
+// Usage: envelope_bench [window_ms]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../src/AudioUtils.h"
+
+// Previous implementation, kept here as the baseline
+static std::vector<float> compute_envelope_reference(const std::vector<float>& samples, int sample_rate, float window_ms) {
+    std::vector<float> envelope_data;
+    envelope_data.reserve(samples.size());
+
+    int window_samples = std::max(1, int(window_ms * 0.001f * sample_rate));
+    int half = std::max(1, window_samples / 2);
+
+    for (int i = 0; i < (int)samples.size(); ++i) {
+        float sum_squares = 0.0f;
+        int start = std::max(0, i - half);
+        int end = std::min((int)samples.size(), i + half);
+
+        for (int j = start; j < end; ++j) {
+            sum_squares += samples[j] * samples[j];
+        }
+
+        envelope_data.push_back(std::sqrt(sum_squares / (end - start)));
+    }
+
+    return envelope_data;
+}
+
+static std::vector<float> make_track(std::size_t sample_count, int sample_rate) {
+    std::vector<float> samples(sample_count);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+
+    for (std::size_t i = 0; i < sample_count; ++i) {
+        float t = float(i) / sample_rate;
+        float beat = std::exp(-8.0f * std::fmod(t, 0.5f));
+        samples[i] = 0.6f * beat * std::sin(2.0f * 3.14159265f * 110.0f * t) + noise(rng);
+    }
+    return samples;
+}
+
+template<typename Func>
+static double time_ms(Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    const int sample_rate = 44100;
+    const float window_ms = argc > 1 ? std::strtof(argv[1], nullptr) : 10.0f;
+    const int durations_min[] = {1, 5, 30};
+
+    std::printf("window: %.1f ms\n", window_ms);
+    std::printf("%8s %14s %14s %10s %12s\n", "minutes", "reference ms", "envelope ms", "speedup", "max error");
+
+    for (int minutes : durations_min) {
+        auto samples = make_track(std::size_t(minutes) * 60 * sample_rate, sample_rate);
+
+        std::vector<float> reference, envelope;
+        double reference_ms = time_ms([&]() { reference = compute_envelope_reference(samples, sample_rate, window_ms); });
+        double envelope_ms = time_ms([&]() { envelope = compute_envelope(samples, sample_rate, window_ms); });
+
+        float max_error = 0.0f;
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            max_error = std::max(max_error, std::abs(reference[i] - envelope[i]));
+        }
+
+        std::printf("%8d %14.1f %14.1f %9.1fx %12.2e\n", minutes, reference_ms, envelope_ms, reference_ms / envelope_ms, max_error);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+//
+// Created by victor on 18/10/26.
+//
+// Compares the JSON and binary project formats on a synthetic show.
+// Usage: project_bench [command_count]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+
+#include "../src/ProjectFile.h"
+
+static ProjectData make_project(std::size_t command_count) {
+    ProjectData p;
+    p.light_count = 12;
+    p.fixtures = makeFixtureLayout(p.light_count);
+    p.max_uuid = 0;
+
+    for (size_t light = 0; light < p.light_count; ++light) {
+        p.groups.push_back(Group{"Light " + std::to_string(light), {light}});
+    }
+    p.groups.push_back(Group{"All", {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}});
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::uniform_int_distribution<int> group(0, int(p.groups.size()) - 1);
+    auto random_color = [&]() { return Color{channel(rng), channel(rng), channel(rng), 255}; };
+
+    // Four commands per keyframe, a keyframe every ~100 ms
+    const std::size_t commands_per_keyframe = 4;
+    for (std::size_t k = 0; k * commands_per_keyframe < command_count; ++k) {
+        Keyframe keyframe{int64_t(k) * 4410, p.max_uuid++};
+        p.keyframes.push_back(keyframe);
+
+        auto& commands = p.keyframe_uuid_to_commands[keyframe.uuid];
+        for (std::size_t c = 0; c < commands_per_keyframe; ++c) {
+            Command command{};
+            command.group_id = group(rng);
+            command.animation.kind = AnimationKind(c % 3);
+            command.animation.toggle = ToggleInfo{true, random_color()};
+            command.animation.gradient = GradientInfo{random_color(), random_color(), GradientKind(c % 4), 0, 22050};
+            command.animation.blink = BlinkInfo{random_color(), random_color(), 0, 11025};
+            retimeCommand(command, keyframe.trigger_sample);
+            commands.push_back(command);
+        }
+    }
+
+    return p;
+}
+
+template<typename Func>
+static double time_ms(Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    const std::size_t command_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    auto project = make_project(command_count);
+
+    auto directory = std::filesystem::temp_directory_path();
+    auto json_path = (directory / "project_bench.json").string();
+    auto binary_path = (directory / "project_bench.elise").string();
+
+    ProjectData json_loaded, binary_loaded;
+    double json_save_ms = time_ms([&]() { saveJson(json_path, project); });
+    double json_load_ms = time_ms([&]() { json_loaded = loadJson(json_path); });
+    double binary_save_ms = time_ms([&]() { saveBinaryProject(binary_path, project); });
+    double binary_load_ms = time_ms([&]() { binary_loaded = loadBinaryProject(binary_path); });
+
+    // Both formats must give back the same show
+    bool same = json_loaded.keyframes.size() == binary_loaded.keyframes.size()
+             && json_loaded.keyframe_uuid_to_commands == binary_loaded.keyframe_uuid_to_commands;
+
+    std::printf("commands: %zu\n", command_count);
+    std::printf("%8s %12s %12s %12s\n", "format", "save ms", "load ms", "size KiB");
+    std::printf("%8s %12.1f %12.1f %12.1f\n", "json", json_save_ms, json_load_ms, std::filesystem::file_size(json_path) / 1024.0);
+    std::printf("%8s %12.1f %12.1f %12.1f\n", "binary", binary_save_ms, binary_load_ms, std::filesystem::file_size(binary_path) / 1024.0);
+    std::printf("round trip: %s\n", same ? "identical" : "DIFFERENT");
+
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(binary_path);
+    return same ? 0 : 1;
+}
@@ -31,6 +31,25 @@ namespace Odin
 		AddShader(bs_downsample_frag);
 		AddShader(bs_upsample_frag);
 		AddShader(bs_combine_frag);
+
+		knee_location = shaders.at(0).getUniformLocation("knee");
+		threshold_location = shaders.at(0).getUniformLocation("threshold");
+		blur_dir_location = shaders.at(1).getUniformLocation("blur_dir");
+
+		// Samplers and constants never change, set them once
+		shaders.at(0).use();
+		shaders.at(0).setInt("screenTexture", 0);
+		shaders.at(1).use();
+		shaders.at(1).setInt("screenTexture", 0);
+		shaders.at(2).use();
+		shaders.at(2).setInt("screenTexture", 0);
+		shaders.at(3).use();
+		shaders.at(3).setInt("screenTexture", 0);
+		shaders.at(3).setFloat("filterRadius", 0.005f);
+		shaders.at(4).use();
+		shaders.at(4).setInt("mainTex", 0);
+		shaders.at(4).setInt("bloomTex", 1);
+		glUseProgram(0);
 	}
 
 	void Bloom::Apply(FrameBuffer& fbo_in, FrameBuffer& fbo_out, int w_width, int w_height)
@@ -48,9 +67,8 @@ namespace Odin
 		
 		// First pass (filtering)
 		shaders.at(0).use();
-		shaders.at(0).setFloat("knee", knee);
-		shaders.at(0).setFloat("threshold", threshold);
-		shaders.at(0).setInt("screenTexture", 0);
+		shaders.at(0).setFloat(knee_location, knee);
+		shaders.at(0).setFloat(threshold_location, threshold);
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, fbo_in.GetTexture());
 		Draw(*fbos.at(0));
@@ -59,20 +77,18 @@ namespace Odin
 
 	   // Second pass (horizontal blur)
 	   shaders.at(1).use();
-	   shaders.at(1).setVec2("blur_dir", 1, 0);
-	   shaders.at(1).setInt("screenTexture", 0);
+	   shaders.at(1).setVec2(blur_dir_location, 1, 0);
 	   glBindTexture(GL_TEXTURE_2D, fbos.at(0)->GetTexture());
 	   Draw(*fbos.at(1));
 
 	   // Third pass (vertical blur)
-	   shaders.at(1).setVec2("blur_dir", 0, 1);
+	   shaders.at(1).setVec2(blur_dir_location, 0, 1);
 	   glBindTexture(GL_TEXTURE_2D, fbos.at(1)->GetTexture());
 	   Draw(*fbos.at(0));
 	
 
 		//Fourth pass (first down sampling) : x2
 		shaders.at(2).use();
-		shaders.at(2).setInt("screenTexture", 0);
 		glBindTexture(GL_TEXTURE_2D, fbos.at(0)->GetTexture());
 		glViewport(0, 0, width / 2, height / 2);
 		Draw(*fbos.at(2));
@@ -108,8 +124,6 @@ namespace Odin
 		glBlendEquation(GL_FUNC_ADD);
 
 		shaders.at(3).use();
-		shaders.at(3).setInt("screenTexture", 0);
-		shaders.at(3).setFloat("filterRadius", 0.005f);
 
 		for (int i = 5; i > 0; i--)
 		{
@@ -123,8 +137,6 @@ namespace Odin
 
 		// Mix main image and computed bloom
 		shaders.at(4).use();
-		shaders.at(4).setInt("mainTex", 0);
-		shaders.at(4).setInt("bloomTex", 1);
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, fbo_in.GetTexture());
 
@@ -17,6 +17,11 @@ namespace Odin
 		float threshold = 1;
 
 	private:
+		// Uniforms changing every frame, resolved once in Init
+		GLint knee_location = -1;
+		GLint threshold_location = -1;
+		GLint blur_dir_location = -1;
+
 		void Rescale(int w_width, int w_height);
 		void Draw(FrameBuffer& out);
 		void ClearAll();
@@ -44,6 +44,10 @@ namespace Odin
 		InitVAO();
 
 		AddShader(pp_default_fragment);
+
+		shaders.at(0).use();
+		shaders.at(0).setInt("screenTexture", 0);
+		glUseProgram(0);
 	}
 
 	void Effect::Apply(FrameBuffer& fbo_in, FrameBuffer& fbo_out, int w_width, int w_height)
@@ -53,7 +57,6 @@ namespace Odin
 		{
 			shaders.at(0).use();
 		}
-		shaders.at(0).setInt("screenTexture", 0);
 
 		glBindTexture(GL_TEXTURE_2D, fbo_in.GetTexture());
 
@@ -4,11 +4,16 @@
 
 #include "Renderer.h"
 
+#include <algorithm>
+#include <cstddef>
+
 namespace Odin {
     Renderer::Renderer() = default;
 
     void Renderer::InitRenderer(int width, int height) {
         light_shader = GShader(light_vert, light_frag, true);
+        light_shader.use();
+        light_shader.setFloat("uIntensity", 5.f);
 
         InitVAO();
 
@@ -30,7 +35,7 @@ namespace Odin {
         return fbo_output;
     }
 
-    void Renderer::Render(const std::array<glm::vec4, 12> &windows_colors) {
+    void Renderer::Render(const std::vector<glm::vec4> &windows_colors) {
 
         glViewport(0, 0, viewport_width, viewport_height);
 
@@ -40,27 +45,23 @@ namespace Odin {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Draw the lights
-        light_shader.use();
-        glBindVertexArray(quadVAO);
+        const size_t light_count = std::min(fixtures.size(), windows_colors.size());
 
-        const float y_top = 0.6f;
-        const float y_mid = 0.0f;
-        const float y_bot = -0.6f;
-
-        const float x_spacing = 0.3f;
-
-        for (int i = 0; i < 12; ++i) {
-            glm::vec2 pos; float scale = 0.24f;
-            if (i < 5) pos = { -0.8f + x_spacing * i,  y_top };
-            else if (i < 7) pos = { -0.2f + x_spacing * (i - 5), y_mid };
-            else pos = { -0.5f + x_spacing * (i - 7), y_bot };
+        if (are_fixtures_dirty) {
+            glBindBuffer(GL_ARRAY_BUFFER, fixtureVBO);
+            glBufferData(GL_ARRAY_BUFFER, fixtures.size() * sizeof(Fixture), fixtures.data(), GL_STATIC_DRAW);
+            are_fixtures_dirty = false;
+        }
 
-            light_shader.setVec4("uColor", windows_colors.at(i) * 5.f);
-            light_shader.setVec2("uPosition", glm::vec2(pos[0], pos[1]));
-            light_shader.setFloat("uScale", scale);
+        // Orphan the previous buffer so the driver doesn't wait for the last frame to be drawn
+        glBindBuffer(GL_ARRAY_BUFFER, colorVBO);
+        glBufferData(GL_ARRAY_BUFFER, light_count * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, light_count * sizeof(glm::vec4), windows_colors.data());
 
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-        }
+        light_shader.use();
+        glBindVertexArray(quadVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, GLsizei(light_count));
+        glBindVertexArray(0);
 
         // Prepare the output framebuffer
         fbo_output.Use();
@@ -83,6 +84,11 @@ namespace Odin {
         bloom.Apply(fbo_postProcess, fbo_output, viewport_width, viewport_height);
     }
 
+    void Renderer::setFixtures(const std::vector<Fixture> &fixtures) {
+        this->fixtures = fixtures;
+        are_fixtures_dirty = true;
+    }
+
     void Renderer::setViewport(int width, int height) {
         viewport_height = height;
         viewport_width = width;
@@ -95,20 +101,39 @@ namespace Odin {
     void Renderer::InitVAO() {
         float quadVertices[] = {
             // pos
-            -0.25f, -0.75f,
-             0.25f, -0.75f,
-            -0.25f,  0.75f,
-            -0.25f,  0.75f,
-             0.25f,  0.75f,
-             0.25f, -0.75f,
+            -0.5f, -0.5f,
+             0.5f, -0.5f,
+            -0.5f,  0.5f,
+            -0.5f,  0.5f,
+             0.5f,  0.5f,
+             0.5f, -0.5f,
         };
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
+        glGenBuffers(1, &fixtureVBO);
+        glGenBuffers(1, &colorVBO);
         glBindVertexArray(quadVAO);
+
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);
+
+        // Fixture position and size, once per instance
+        glBindBuffer(GL_ARRAY_BUFFER, fixtureVBO);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Fixture), (void*)offsetof(Fixture, position));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Fixture), (void*)offsetof(Fixture, size));
+        glVertexAttribDivisor(2, 1);
+
+        // Light color, once per instance
+        glBindBuffer(GL_ARRAY_BUFFER, colorVBO);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+        glVertexAttribDivisor(3, 1);
+
         glBindVertexArray(0);
     }
 }
\ No newline at end of file
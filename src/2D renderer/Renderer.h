@@ -9,10 +9,11 @@
 #include "Framebuffer.h"
 #include "Texture.h"
 #include "../LightManager.h"
+#include "../FixtureLayout.h"
 #include "PostProcessing/Effects/Bloom/Bloom.h"
 #include "default_shaders.h"
 #include "../../libs/glm/glm.hpp"
-#include <array>
+#include <vector>
 
 
 namespace Odin {
@@ -24,7 +25,10 @@ namespace Odin {
 
         unsigned int GetTexture();
         const FrameBuffer& GetFboOut();
-        void Render(const std::array<glm::vec4, 12>& windows_colors);
+        // One color per fixture, extra colors or fixtures are ignored
+        void Render(const std::vector<glm::vec4>& windows_colors);
+
+        void setFixtures(const std::vector<Fixture>& fixtures);
 
         void setViewport(int width, int height);
 
@@ -34,6 +38,13 @@ namespace Odin {
         GLuint quadVAO = 0;
         GLuint quadVBO = 0;
 
+        // Per instance attributes: the layout only changes with the fixtures, the colors every frame
+        GLuint fixtureVBO = 0;
+        GLuint colorVBO = 0;
+
+        std::vector<Fixture> fixtures = defaultFixtureLayout();
+        bool are_fixtures_dirty = true;
+
         Bloom bloom;
         Effect dummy_effect;
 
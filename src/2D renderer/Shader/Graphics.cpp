@@ -69,4 +69,6 @@ GShader::GShader(const char* vertex_data_or_path, const char* fragment_data_or_p
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    cacheUniformLocations();
 }
@@ -1,5 +1,7 @@
 #include "Shader.h"
 
+#include <algorithm>
+
 Shader::Shader() {
     flags = shaderFlags_None;
 }
@@ -11,62 +13,162 @@ void Shader::use()
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    setBool(getUniformLocation(name), value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    setInt(getUniformLocation(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    setFloat(getUniformLocation(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec2(getUniformLocation(name), value);
 }
 
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    setVec2(getUniformLocation(name), x, y);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec3(getUniformLocation(name), value);
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    setVec3(getUniformLocation(name), x, y, z);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    setVec4(getUniformLocation(name), value);
 }
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    setVec4(getUniformLocation(name), x, y, z, w);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat2(getUniformLocation(name), mat);
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat3(getUniformLocation(name), mat);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    setMat4(getUniformLocation(name), mat);
+}
+
+void Shader::cacheUniformLocations()
+{
+    uniform_locations.clear();
+
+    int uniform_count = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniform_count);
+
+    char name[256];
+    for (int i = 0; i < uniform_count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, sizeof(name), &length, &size, &type, name);
+
+        std::string uniform_name(name, length);
+        GLint location = glGetUniformLocation(ID, uniform_name.c_str());
+        uniform_locations.emplace_back(uniform_name, location);
+
+        // Arrays are reported as "name[0]", also accept the bare name
+        if (uniform_name.size() > 3 && uniform_name.ends_with("[0]"))
+            uniform_locations.emplace_back(uniform_name.substr(0, uniform_name.size() - 3), location);
+    }
+
+    std::sort(uniform_locations.begin(), uniform_locations.end());
+}
+
+GLint Shader::getUniformLocation(const std::string& name) const
+{
+    auto it = std::lower_bound(uniform_locations.begin(), uniform_locations.end(), name,
+        [](const std::pair<std::string, GLint>& entry, const std::string& key) { return entry.first < key; });
+
+    if (it != uniform_locations.end() && it->first == name) return it->second;
+
+    // Unknown or optimized out uniform: ask once, and remember the answer (possibly -1)
+    GLint location = glGetUniformLocation(ID, name.c_str());
+    uniform_locations.insert(it, {name, location});
+    return location;
+}
+
+void Shader::setBool(GLint location, bool value) const
+{
+    glUniform1i(location, (int)value);
+}
+
+void Shader::setInt(GLint location, int value) const
+{
+    glUniform1i(location, value);
+}
+
+void Shader::setFloat(GLint location, float value) const
+{
+    glUniform1f(location, value);
+}
+
+void Shader::setVec2(GLint location, const glm::vec2& value) const
+{
+    glUniform2fv(location, 1, &value[0]);
+}
+
+void Shader::setVec2(GLint location, float x, float y) const
+{
+    glUniform2f(location, x, y);
+}
+
+void Shader::setVec3(GLint location, const glm::vec3& value) const
+{
+    glUniform3fv(location, 1, &value[0]);
+}
+
+void Shader::setVec3(GLint location, float x, float y, float z) const
+{
+    glUniform3f(location, x, y, z);
+}
+
+void Shader::setVec4(GLint location, const glm::vec4& value) const
+{
+    glUniform4fv(location, 1, &value[0]);
+}
+
+void Shader::setVec4(GLint location, float x, float y, float z, float w) const
+{
+    glUniform4f(location, x, y, z, w);
+}
+
+void Shader::setMat2(GLint location, const glm::mat2& mat) const
+{
+    glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat3(GLint location, const glm::mat3& mat) const
+{
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat4(GLint location, const glm::mat4& mat) const
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type)
@@ -7,6 +7,8 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
+#include <vector>
 #include "../../../libs/glad/include/glad/glad.h" // include glad to get all the required OpenGL headers
 
 enum ShaderFlags
@@ -50,8 +52,31 @@ public:
     void setMat3(const std::string& name, const glm::mat3& mat) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
+    // Resolve the location of every active uniform, must be called after linking
+    void cacheUniformLocations();
+    // Cached lookup, only names that aren't active uniforms ever reach the driver (once)
+    GLint getUniformLocation(const std::string& name) const;
+
+    // Same setters taking a location from getUniformLocation, for the per-frame paths
+    void setBool(GLint location, bool value) const;
+    void setInt(GLint location, int value) const;
+    void setFloat(GLint location, float value) const;
+    void setVec2(GLint location, const glm::vec2& value) const;
+    void setVec2(GLint location, float x, float y) const;
+    void setVec3(GLint location, const glm::vec3& value) const;
+    void setVec3(GLint location, float x, float y, float z) const;
+    void setVec4(GLint location, const glm::vec4& value) const;
+    void setVec4(GLint location, float x, float y, float z, float w) const;
+    void setMat2(GLint location, const glm::mat2& mat) const;
+    void setMat3(GLint location, const glm::mat3& mat) const;
+    void setMat4(GLint location, const glm::mat4& mat) const;
+
 protected:
     void checkCompileErrors(unsigned int shader, std::string type);
+
+private:
+    // Flat map sorted by name
+    mutable std::vector<std::pair<std::string, GLint>> uniform_locations;
 };
 
 
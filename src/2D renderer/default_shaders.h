@@ -5,16 +5,21 @@
 #ifndef DEFAULT_SHADERS_H
 #define DEFAULT_SHADERS_H
 
+// One instance per light: the unit quad is placed by the fixture layout and tinted by the light color
 inline const char* light_vert = R""""(
 #version 330 core
 layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aFixturePosition;
+layout (location = 2) in vec2 aFixtureSize;
+layout (location = 3) in vec4 aColor;
 
-uniform vec2 uPosition;
-uniform float uScale;
+uniform float uIntensity;
+
+out vec4 vColor;
 
 void main() {
-    vec2 scaled = aPos * uScale;
-    gl_Position = vec4(scaled + uPosition, 0.0, 1.0);
+    vColor = aColor * uIntensity;
+    gl_Position = vec4(aFixturePosition + aPos * aFixtureSize, 0.0, 1.0);
 }
 )"""";
 
@@ -22,10 +27,10 @@ inline const char* light_frag = R""""(
 #version 330 core
 out vec4 FragColor;
 
-uniform vec4 uColor;
+in vec4 vColor;
 
 void main() {
-    FragColor = uColor;
+    FragColor = vColor;
 }
 )"""";
 
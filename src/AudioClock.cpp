@@ -0,0 +1,52 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "AudioClock.h"
+
+#include <cmath>
+
+void AudioClock::publish(int64_t sample, double rate, clock::time_point time) {
+    auto seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    time_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count(), std::memory_order_relaxed);
+    this->sample.store(sample, std::memory_order_relaxed);
+    this->rate.store(rate, std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+AudioClock::Point AudioClock::read() const {
+    while (true) {
+        auto before = sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;   // Write in progress, it only takes a few nanoseconds
+
+        Point point{
+            clock::time_point(std::chrono::nanoseconds(time_ns.load(std::memory_order_relaxed))),
+            sample.load(std::memory_order_relaxed),
+            rate.load(std::memory_order_relaxed)
+        };
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) return point;
+    }
+}
+
+void AudioClock::setOutputLatency(double seconds) {
+    output_latency.store(seconds, std::memory_order_relaxed);
+}
+
+double AudioClock::getOutputLatency() const {
+    return output_latency.load(std::memory_order_relaxed);
+}
+
+int64_t AudioClock::sampleAt(clock::time_point time, int64_t fallback) const {
+    auto point = read();
+    if (point.rate <= 0.0) return fallback;
+
+    // The first sample of the published buffer is heard output_latency after the callback
+    double elapsed = std::chrono::duration<double>(time - point.time).count() - getOutputLatency();
+    return point.sample + int64_t(std::llround(elapsed * point.rate));
+}
@@ -0,0 +1,52 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef AUDIOCLOCK_H
+#define AUDIOCLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+// Maps wall clock time to the song sample coming out of the speakers.
+// The audio callback publishes one (time, sample, rate) point per buffer through a seqlock: the writer never
+// waits and readers retry in the rare case they overlap a write. Readers extrapolate from the last point,
+// so the position moves smoothly between callbacks instead of jumping a buffer at a time.
+class AudioClock {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Point {
+        clock::time_point time;     // When the buffer was handed to the device
+        int64_t sample;             // Song sample at the start of that buffer
+        double rate;                // Song samples per second, 0 when stopped
+    };
+
+    // Single producer: only the audio callback, or any thread while the device is stopped
+    void publish(int64_t sample, double rate, clock::time_point time = clock::now());
+
+    Point read() const;
+
+    // Time between a buffer being handed to the device and its first sample being heard
+    void setOutputLatency(double seconds);
+    double getOutputLatency() const;
+
+    // Sample heard at `time`, with the output latency taken into account. `fallback` if the clock is stopped
+    int64_t sampleAt(clock::time_point time, int64_t fallback) const;
+
+private:
+    std::atomic<uint32_t> sequence{0};  // Odd while a write is in progress
+
+    // Atomics so the torn reads the seqlock throws away are not data races
+    std::atomic<int64_t> time_ns{0};
+    std::atomic<int64_t> sample{0};
+    std::atomic<double> rate{0.0};
+
+    std::atomic<double> output_latency{0.0};
+};
+
+
+
+#endif //AUDIOCLOCK_H
@@ -9,43 +9,91 @@
 #include <iostream>
 #include <numeric>
 
+namespace {
+    // Catmull-Rom interpolation around a fractional position, edges clamped
+    float interpolateSample(std::span<const float> samples, double position) {
+        const int64_t last = int64_t(samples.size()) - 1;
+        const int64_t i = int64_t(position);
+        const float t = float(position - double(i));
+
+        const float y0 = samples[std::clamp<int64_t>(i - 1, 0, last)];
+        const float y1 = samples[std::clamp<int64_t>(i, 0, last)];
+        const float y2 = samples[std::clamp<int64_t>(i + 1, 0, last)];
+        const float y3 = samples[std::clamp<int64_t>(i + 2, 0, last)];
+
+        const float a = -0.5f * y0 + 1.5f * y1 - 1.5f * y2 + 0.5f * y3;
+        const float b = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+        const float c = -0.5f * y0 + 0.5f * y2;
+        return ((a * t + b) * t + c) * t + y1;
+    }
+}
 
 
 AudioManager::AudioManager() {
-
+    auto empty = std::make_shared<SampleStore>(0, sample_rate);
+    empty->finish();
+    publishSamples(std::move(empty));
 }
 
 AudioManager::~AudioManager() {
-    stop();
+    stopDecoding();
+
+    if (isDeviceInitialized) {
+        ma_device_uninit(&device);
+        isDeviceInitialized = false;
+    }
 }
 
 bool AudioManager::loadMP3(const std::string& path) {
+    stopDecoding();
+
     mp3_path = path;
     ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, sample_rate);
-    ma_decoder decoder;
+    auto decoder = std::make_unique<ma_decoder>();
 
-    if (ma_decoder_init_file(path.c_str(), &config, &decoder) != MA_SUCCESS)
+    if (ma_decoder_init_file(path.c_str(), &config, decoder.get()) != MA_SUCCESS)
         return false;
 
-    ma_uint64 frameCount;
-    float* audioData = nullptr;
+    // The store is allocated once, so the length has to be known before decoding
+    ma_uint64 frameCount = 0;
+    if (ma_decoder_get_length_in_pcm_frames(decoder.get(), &frameCount) != MA_SUCCESS || frameCount == 0) {
+        ma_decoder_uninit(decoder.get());
 
-    if (ma_decode_file(path.c_str(), &config, &frameCount, (void**)&audioData) != MA_SUCCESS) {
-        ma_decoder_uninit(&decoder);
-        return false;
+        // Stream without a known length, decode it in one go
+        float* audioData = nullptr;
+        if (ma_decode_file(path.c_str(), &config, &frameCount, (void**)&audioData) != MA_SUCCESS)
+            return false;
+
+        auto store = std::make_shared<SampleStore>(frameCount, config.sampleRate);
+        std::copy_n(audioData, frameCount, store->writePointer());
+        store->commit(frameCount);
+        store->finish();
+        ma_free(audioData, nullptr);
+
+        publishSamples(std::move(store));
+        return true;
     }
 
-    original_samples.assign(audioData, audioData + frameCount);
-    sample_rate = decoder.outputSampleRate;
+    sample_rate = decoder->outputSampleRate;
+    auto store = std::make_shared<SampleStore>(frameCount, sample_rate);
+    publishSamples(store);
 
-    ma_free(audioData, nullptr);
-    ma_decoder_uninit(&decoder);
+    cancel_decode = false;
+    decode_thread = std::thread(&AudioManager::decodeLoop, this, std::move(decoder), std::move(store));
 
     return true;
 }
 
-const std::vector<float> & AudioManager::getOriginalSamples() const {
-    return original_samples;
+void AudioManager::waitUntilLoaded() {
+    if (decode_thread.joinable()) decode_thread.join();
+}
+
+std::span<const float> AudioManager::getOriginalSamples() const {
+    return samples->samples();
+}
+
+std::shared_ptr<const SampleStore> AudioManager::getSampleStore() const {
+    return samples;
 }
 
 int AudioManager::getSampleRate() const {
@@ -63,16 +111,20 @@ int AudioManager::getChannels() const {
 void AudioManager::play(const int start_sample, float speed_mul) {
     if (is_playing) return;
 
-    if (!isDeviceInitialized) {
-        initPlaybackDevice(speed_mul);
-    }
-
     // Clamp starting position
-    size_t startFrame = start_sample;
-    playheadPosition = std::min(startFrame, original_samples.size());
+    size_t startFrame = std::max(start_sample, 0);
+    startFrame = std::min(startFrame, samples->size());
+
+    reclaimRetiredSamples();
+
+    setSpeed(speed_mul);
+    playheadPosition = startFrame;
+    pending_seek = int64_t(startFrame);
+    pending_grain = no_grain;
 
+    // The seek is posted before the callback can see is_playing
     is_playing = true;
-    ma_device_start(&device);
+    startPlaybackDevice();
 }
 
 void AudioManager::pause() {
@@ -80,12 +132,26 @@ void AudioManager::pause() {
 }
 
 void AudioManager::stop() {
+    // Waits for the running callback, so this thread is the only clock producer afterwards
     if (isDeviceInitialized) {
-        ma_device_uninit(&device);
-        isDeviceInitialized = false;
+        ma_device_stop(&device);
     }
     is_playing = false;
     playheadPosition = 0;
+
+    audio_clock.publish(0, 0.0);
+}
+
+void AudioManager::setSpeed(float speed_mul) {
+    target_speed = std::max(speed_mul, 0.01f);
+}
+
+void AudioManager::playGrain(int64_t start_sample) {
+    const auto song_size = samples->size();
+    if (is_playing || song_size == 0) return;
+
+    startPlaybackDevice();
+    pending_grain = std::clamp<int64_t>(start_sample, 0, song_size - 1);
 }
 
 bool AudioManager::isPlaying() const {
@@ -96,31 +162,67 @@ size_t AudioManager::getPlayheadPosition() const {
     return playheadPosition;
 }
 
+int64_t AudioManager::getHeardPosition(AudioClock::clock::time_point time) const {
+    int64_t position = audio_clock.sampleAt(time, playheadPosition);
+    return std::clamp<int64_t>(position, 0, samples->size());
+}
+
 void AudioManager::dataCallback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount) {
     auto* self = static_cast<AudioManager*>(pDevice->pUserData);
     float* out = (float*)pOutput;
     memset(out, 0, frameCount * sizeof(float));
 
-    if (!self->is_playing) return;
+    // Enter the read side before loading the buffer, see reclaimRetiredSamples
+    self->callback_epoch.fetch_add(1);
+    const SampleStore* buffer = self->live_samples.load();
+
+    if (!self->is_playing) {
+        self->audio_clock.publish(self->playheadPosition, 0.0);
+        self->renderGrain(*buffer, out, frameCount);
+    } else {
+        self->renderPlayback(*buffer, out, frameCount, pDevice->sampleRate);
+    }
+
+    self->callback_epoch.fetch_add(1);
+}
+
+void AudioManager::renderPlayback(const SampleStore &buffer, float *out, uint32_t frameCount, uint32_t deviceSampleRate) {
+    int64_t seek = pending_seek.exchange(no_seek);
+    if (seek != no_seek) read_position = double(seek);
 
-    const auto& samples = self->original_samples;
-    size_t remaining = samples.size() - self->playheadPosition;
+    // Completion first: if it is set, the prefix loaded after it is the whole song
+    const bool is_complete = buffer.isComplete();
+    const auto song = buffer.samples();
 
-    ma_uint32 framesToCopy = (ma_uint32)std::min<size_t>(frameCount, remaining);
+    // Song samples per device sample at speed 1, in case the song was decoded at another rate
+    const double base_step = double(buffer.getSampleRate()) / double(deviceSampleRate);
 
-    memcpy(out, samples.data() + self->playheadPosition, framesToCopy * sizeof(float));
-    self->playheadPosition += framesToCopy;
+    // Ramp the speed across the buffer, a step would click
+    const double end_speed = target_speed.load(std::memory_order_relaxed);
+    const double speed_step = (end_speed - current_speed) / double(frameCount);
 
-    if (framesToCopy < frameCount) {
-        // Reached end
-        self->is_playing = false;
+    audio_clock.publish(int64_t(read_position), deviceSampleRate * base_step * 0.5 * (current_speed + end_speed));
+
+    uint32_t i = 0;
+    for (; i < frameCount && read_position < double(song.size()); ++i) {
+        out[i] = interpolateSample(song, read_position);
+        current_speed += speed_step;
+        read_position += base_step * current_speed;
+    }
+    current_speed = end_speed;
+
+    playheadPosition = std::min<uint64_t>(uint64_t(read_position), song.size());
+
+    if (i < frameCount && is_complete) {
+        // Reached end. Otherwise the decoder is behind, the rest of the buffer stays silent
+        is_playing = false;
     }
 }
 
-void AudioManager::initPlaybackDevice(float speed_mul) {
+void AudioManager::initPlaybackDevice() {
 
     ma_device_config config = ma_device_config_init(ma_device_type_playback);
-    config.sampleRate = int(float(sample_rate) * speed_mul);
+    config.sampleRate = sample_rate;
     config.playback.format = ma_format_f32;
     config.playback.channels = 1;
     config.dataCallback = dataCallback;
@@ -131,4 +233,79 @@ void AudioManager::initPlaybackDevice(float speed_mul) {
     }
 
     isDeviceInitialized = true;
+
+    // Whole device buffer: a sample handed to the callback is heard once the periods before it are played
+    auto& playback = device.playback;
+    if (playback.internalSampleRate > 0) {
+        audio_clock.setOutputLatency(double(playback.internalPeriodSizeInFrames) * playback.internalPeriods / playback.internalSampleRate);
+    }
+}
+
+void AudioManager::startPlaybackDevice() {
+    if (!isDeviceInitialized) {
+        initPlaybackDevice();
+    }
+
+    if (!ma_device_is_started(&device)) {
+        ma_device_start(&device);
+    }
+}
+
+void AudioManager::renderGrain(const SampleStore &buffer, float *out, uint32_t frameCount) {
+    int64_t grain = pending_grain.exchange(no_grain);
+    if (grain != no_grain) {
+        grain_position = grain;
+        grain_remaining = grain_length;
+    }
+
+    const auto song = buffer.samples();
+    for (uint32_t i = 0; i < frameCount && grain_remaining > 0; ++i, --grain_remaining) {
+        if (grain_position >= int64_t(song.size())) {
+            grain_remaining = 0;
+            break;
+        }
+
+        // Linear fades on both ends, a raw cut would click
+        uint32_t played = grain_length - grain_remaining;
+        float gain = std::min({1.0f, float(played) / grain_fade, float(grain_remaining) / grain_fade});
+        out[i] = song[grain_position++] * gain;
+    }
+}
+
+void AudioManager::publishSamples(std::shared_ptr<const SampleStore> buffer) {
+    live_samples.store(buffer.get());
+
+    // Epoch seen after the swap: if no callback was running, none can still hold the old buffer,
+    // otherwise the old buffer is safe as soon as that callback returns and the epoch moves on
+    if (samples) retired_samples.emplace_back(std::move(samples), callback_epoch.load());
+    samples = std::move(buffer);
+
+    reclaimRetiredSamples();
+}
+
+void AudioManager::reclaimRetiredSamples() {
+    const uint64_t epoch = callback_epoch.load();
+    std::erase_if(retired_samples, [epoch](const auto& retired) {
+        return retired.second % 2 == 0 || retired.second != epoch;
+    });
+}
+
+void AudioManager::stopDecoding() {
+    cancel_decode = true;
+    if (decode_thread.joinable()) decode_thread.join();
+}
+
+void AudioManager::decodeLoop(std::unique_ptr<ma_decoder> decoder, std::shared_ptr<SampleStore> store) {
+    // The length is exact for the formats that report one, anything past it is dropped
+    while (!cancel_decode && store->remaining() > 0) {
+        ma_uint64 count = std::min(decode_chunk_size, store->remaining());
+        ma_uint64 read = 0;
+        ma_result result = ma_decoder_read_pcm_frames(decoder.get(), store->writePointer(), count, &read);
+        store->commit(read);
+
+        if (result != MA_SUCCESS || read < count) break;
+    }
+
+    store->finish();
+    ma_decoder_uninit(decoder.get());
 }
@@ -8,7 +8,13 @@
 
 #include "../libs/kiss_fft.hh"
 #include "../libs/miniaudio.h"
+#include "AudioClock.h"
+#include "SampleStore.h"
+#include <atomic>
+#include <memory>
+#include <span>
 #include <thread>
+#include <utility>
 
 
 
@@ -17,9 +23,16 @@ public:
     AudioManager();
     ~AudioManager();
 
+    // Returns once the first samples can be decoded, the rest of the song is decoded in the background
+    // into the sample store
     bool loadMP3(const std::string& path);
 
-    const std::vector<float>& getOriginalSamples() const;
+    // Block until the whole song is decoded
+    void waitUntilLoaded();
+
+    // The samples decoded so far
+    std::span<const float> getOriginalSamples() const;
+    std::shared_ptr<const SampleStore> getSampleStore() const;
     int getSampleRate() const;
     std::string getMP3Path() const;
     int getChannels() const;
@@ -28,25 +41,75 @@ public:
     void pause();
     void stop();
 
+    // Takes effect at the next audio buffer, ramped over it. The device keeps running
+    void setSpeed(float speed_mul);
+
+    // Play a short faded snippet starting at `start_sample`, for scrubbing. Ignored while playing,
+    // a new grain replaces the one still sounding
+    void playGrain(int64_t start_sample);
+
     bool isPlaying() const;
 
     size_t getPlayheadPosition() const;
 
+    // Sample actually heard at `time`: extrapolated from the audio clock, output latency included.
+    // Falls back to the playhead when stopped
+    int64_t getHeardPosition(AudioClock::clock::time_point time = AudioClock::clock::now()) const;
+
 private:
     static void dataCallback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount);
-    void initPlaybackDevice(float speed_mul = 1.0f);
+    void initPlaybackDevice();
+    void startPlaybackDevice();
+    void renderPlayback(const SampleStore& buffer, float* out, uint32_t frameCount, uint32_t deviceSampleRate);
+    void renderGrain(const SampleStore& buffer, float* out, uint32_t frameCount);
+
+    // UI thread only
+    void publishSamples(std::shared_ptr<const SampleStore> buffer);
+    void reclaimRetiredSamples();
+    void stopDecoding();
+
+    void decodeLoop(std::unique_ptr<ma_decoder> decoder, std::shared_ptr<SampleStore> store);
 
 
 private:
-    std::vector<float> original_samples;
     std::string mp3_path;
     int sample_rate = 44100;
 
+    // The song, swapped RCU style. The audio thread only ever loads the raw pointer: no lock and no
+    // reference count to drop (and maybe free) in the callback. Replaced buffers are kept alive until
+    // every callback that could have loaded them has returned
+    std::shared_ptr<const SampleStore> samples;                                         // UI thread
+    std::atomic<const SampleStore*> live_samples{nullptr};
+    std::atomic<uint64_t> callback_epoch{0};                                            // Odd while a callback runs
+    std::vector<std::pair<std::shared_ptr<const SampleStore>, uint64_t>> retired_samples; // UI thread, with the epoch seen at retirement
+
+    // Background decoding of the current song
+    static constexpr std::size_t decode_chunk_size = 1 << 16;
+    std::thread decode_thread;
+    std::atomic<bool> cancel_decode{false};
+
     ma_device device{};
     bool isDeviceInitialized = false;
 
     std::atomic<bool> is_playing{false};
     std::atomic<uint64_t> playheadPosition{0};
+    AudioClock audio_clock;
+
+    // Varispeed: the device always runs at the song rate, the callback resamples at `speed`.
+    // The UI posts seeks and speeds, the audio thread picks them up at its next buffer
+    static constexpr int64_t no_seek = -1;
+    std::atomic<int64_t> pending_seek{no_seek};
+    std::atomic<float> target_speed{1.0f};
+    double read_position = 0.0;     // Audio thread only, fractional song sample
+    double current_speed = 1.0;     // Audio thread only
+
+    // Scrub grains: the UI posts a start sample, the audio thread picks it up at its next buffer
+    static constexpr int64_t no_grain = -1;
+    static constexpr uint32_t grain_length = 2048;  // ~46 ms at 44.1 kHz
+    static constexpr float grain_fade = 256.f;
+    std::atomic<int64_t> pending_grain{no_grain};
+    int64_t grain_position = 0;     // Audio thread only
+    uint32_t grain_remaining = 0;   // Audio thread only
 
 
 
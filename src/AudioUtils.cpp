@@ -9,78 +9,219 @@
 #include <math.h>
 #include <numeric>
 #include "../libs/kiss_fft.hh"
+#include "ThreadPool.h"
 
-std::vector<float> compute_envelope(const std::vector<float> &samples, int sample_rate, float window_ms) {
-    if (samples.empty()) return {};
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
-    std::vector<float> envelope_data;
+namespace {
+    // Outputs are produced in blocks so the per-sample work can be vectorized around the running sum
+    constexpr std::size_t envelope_block_size = 256;
+    constexpr std::size_t envelope_min_chunk = 1 << 16;
+
+    // out[k] = add[k]^2 - sub[k]^2
+    void square_difference(const float* add, const float* sub, float* out, std::size_t count) {
+        std::size_t k = 0;
+#if defined(__AVX2__)
+        for (; k + 8 <= count; k += 8) {
+            __m256 a = _mm256_loadu_ps(add + k);
+            __m256 b = _mm256_loadu_ps(sub + k);
+            _mm256_storeu_ps(out + k, _mm256_sub_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; k + 4 <= count; k += 4) {
+            float32x4_t a = vld1q_f32(add + k);
+            float32x4_t b = vld1q_f32(sub + k);
+            vst1q_f32(out + k, vsubq_f32(vmulq_f32(a, a), vmulq_f32(b, b)));
+        }
+#endif
+        for (; k < count; ++k) {
+            out[k] = add[k] * add[k] - sub[k] * sub[k];
+        }
+    }
+
+    // out[k] = sqrt(max(0, in[k]) * scale)
+    void scaled_sqrt(const float* in, float* out, float scale, std::size_t count) {
+        std::size_t k = 0;
+#if defined(__AVX2__)
+        const __m256 s = _mm256_set1_ps(scale);
+        const __m256 zero = _mm256_setzero_ps();
+        for (; k + 8 <= count; k += 8) {
+            __m256 v = _mm256_max_ps(_mm256_loadu_ps(in + k), zero);
+            _mm256_storeu_ps(out + k, _mm256_sqrt_ps(_mm256_mul_ps(v, s)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const float32x4_t s = vdupq_n_f32(scale);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        for (; k + 4 <= count; k += 4) {
+            float32x4_t v = vmaxq_f32(vld1q_f32(in + k), zero);
+            vst1q_f32(out + k, vsqrtq_f32(vmulq_f32(v, s)));
+        }
+#endif
+        for (; k < count; ++k) {
+            out[k] = std::sqrt(std::max(0.0f, in[k]) * scale);
+        }
+    }
+
+    // RMS over [max(0, i - half), min(n, i + half)) for every i in [begin, end), using a running sum
+    void envelope_chunk(const float* samples, std::size_t n, std::size_t half, std::size_t begin, std::size_t end, float* out) {
+        // Seed the running sum with the window of the first output. The window reaches over the
+        // chunk edges, so chunks give exactly the same result as a single pass.
+        double sum = 0.0;
+        std::size_t window_start = begin > half ? begin - half : 0;
+        std::size_t window_end = std::min(n, begin + half);
+        for (std::size_t j = window_start; j < window_end; ++j) {
+            sum += double(samples[j]) * samples[j];
+        }
 
-    envelope_data.clear();
-    envelope_data.reserve(samples.size());
+        float diff[envelope_block_size];
+        float sums[envelope_block_size];
 
+        std::size_t i = begin;
+        while (i < end) {
+            bool is_interior = i >= half && i + half < n;
+
+            if (!is_interior) {
+                // Clamped window near the buffer boundaries
+                std::size_t start = i > half ? i - half : 0;
+                std::size_t stop = std::min(n, i + half);
+                out[i] = std::sqrt(float(std::max(0.0, sum)) / float(stop - start));
+
+                if (i + half < n) sum += double(samples[i + half]) * samples[i + half];
+                if (i >= half) sum -= double(samples[i - half]) * samples[i - half];
+                ++i;
+                continue;
+            }
+
+            // Full window: constant count, so the block only needs a prefix sum of square differences
+            std::size_t interior_end = std::min(end, n - half);
+            std::size_t count = std::min(envelope_block_size, interior_end - i);
+
+            square_difference(samples + i + half, samples + i - half, diff, count);
+            for (std::size_t k = 0; k < count; ++k) {
+                sums[k] = float(sum);
+                sum += diff[k];
+            }
+            scaled_sqrt(sums, out + i, 1.0f / float(2 * half), count);
+
+            i += count;
+        }
+    }
+}
+
+std::vector<float> compute_envelope(std::span<const float> samples, int sample_rate, float window_ms) {
+    std::vector<float> envelope_data;
+    extend_envelope(samples, true, sample_rate, window_ms, envelope_data, samples.size());
+    return envelope_data;
+}
+
+void extend_envelope(std::span<const float> samples, bool is_complete, int sample_rate, float window_ms,
+                     std::vector<float> &envelope, std::size_t max_count) {
     // Calculate window size in samples
     int window_samples = int(window_ms * 0.001f * sample_rate);
-    window_samples = std::max(1, window_samples);
+    std::size_t half = std::max(1, window_samples / 2);
+
+    // Until the end of the song is known, the last windows would be clamped to the wrong boundary
+    std::size_t ready = is_complete ? samples.size() : (samples.size() > half ? samples.size() - half : 0);
+
+    const std::size_t begin = envelope.size();
+    if (ready <= begin) return;
+    const std::size_t count = std::min(ready - begin, max_count);
+
+    envelope.resize(begin + count);
 
-    // Calculate RMS envelope
-    for (int i = 0; i < samples.size(); ++i) {
-        float sum_squares = 0.0f;
-        int count = 0;
+    ThreadPool::global().parallel_for(count, envelope_min_chunk, [&](std::size_t chunk_begin, std::size_t chunk_end) {
+        envelope_chunk(samples.data(), samples.size(), half, begin + chunk_begin, begin + chunk_end, envelope.data());
+    });
+}
+
+namespace {
+    constexpr std::size_t note_frame_size = 2048;
+    constexpr std::size_t note_hop_size = 512;
+    constexpr std::size_t note_bin_count = note_frame_size / 2;
+    constexpr std::size_t note_min_frames_per_chunk = 64;
+
+    // Per-thread STFT state, allocated once per chunk and reused by every frame
+    struct SpectrumStage {
+        // Real input FFT: a complex FFT of half the frame size
+        kissfft<float> fft{note_bin_count, false};
+        std::vector<float> frame = std::vector<float>(note_frame_size);
+        std::vector<std::complex<float>> spectrum = std::vector<std::complex<float>>(note_bin_count);
+
+        // Rolling magnitude buffer, [0] holds the current frame and [1] the previous one
+        std::vector<float> magnitudes[2] = {std::vector<float>(note_bin_count), std::vector<float>(note_bin_count)};
+
+        // Fill magnitudes[0] with the spectrum magnitude of the frame starting at `frame_start`
+        // Returns the index of the loudest bin.
+        std::size_t analyse(const float* frame_start, const std::vector<float>& window) {
+            for (std::size_t i = 0; i < note_frame_size; ++i) {
+                frame[i] = frame_start[i] * window[i];
+            }
+            fft.transform_real(frame.data(), spectrum.data());
 
-        // Calculate RMS over window centered at current sample
-        int start = std::max(0, i - window_samples / 2);
-        int end = std::min((int)samples.size(), i + window_samples / 2);
+            // Bin 0 packs the DC (real) and Nyquist (imaginary) values
+            auto& current = magnitudes[0];
+            current[0] = std::abs(spectrum[0].real());
 
-        for (int j = start; j < end; ++j) {
-            sum_squares += samples[j] * samples[j];
-            count++;
+            std::size_t peak = 0;
+            for (std::size_t k = 1; k < note_bin_count; ++k) {
+                current[k] = std::abs(spectrum[k]);
+                if (current[k] > current[peak]) peak = k;
+            }
+            return peak;
         }
+    };
 
-        float rms = std::sqrt(sum_squares / count);
-        envelope_data.push_back(rms);
+    std::vector<float> hann_table(std::size_t N) {
+        std::vector<float> window(N);
+        for (std::size_t i = 0; i < N; ++i) window[i] = hann(i, N);
+        return window;
     }
-
-    return envelope_data;
 }
 
-std::vector<DetectedNote> detectNotes(const std::vector<float> &samples, int sample_rate) {
-    const std::size_t frameSize = 2048;
-    const std::size_t hopSize   = 512;
-    std::size_t numFrames = 1 + (samples.size() - frameSize) / hopSize;
+std::vector<DetectedNote> detectNotes(std::span<const float> samples, int sample_rate) {
+    if (samples.size() < note_frame_size) return {};
 
-    // 1) Pre-allocate
-    std::vector<std::vector<std::complex<float>>> spectra(numFrames);
+    const std::size_t numFrames = 1 + (samples.size() - note_frame_size) / note_hop_size;
+    const std::vector<float> window = hann_table(note_frame_size);
+
+    // 1) Only one flux and pitch value per frame is kept, the spectra are streamed
     std::vector<float> flux(numFrames, 0.0f);
     std::vector<float> pitches(numFrames, 0.0f);
 
-    // 2) FFT & Pitch/Flux per frame
-    kissfft<float> fft(frameSize, false);
-    for (std::size_t n = 0; n < numFrames; ++n) {
-        std::size_t offset = n * hopSize;
-        // 2a) copy + window
-        std::vector<std::complex<float>> X(frameSize);
-        for (std::size_t i = 0; i < frameSize; ++i)
-            X[i].real(samples[offset + i] * hann(i, frameSize));
-        // 2b) FFT
-        fft.transform(X.data(), X.data());
-        spectra[n] = X;
-        // 2c) spectral flux
-        if (n > 0) {
-            float sum = 0;
-            for (std::size_t k = 0; k < frameSize/2; ++k) {
-                float d = std::abs(X[k]) - std::abs(spectra[n-1][k]);
-                sum += (d > 0 ? d : 0);
+    // 2) FFT & Pitch/Flux per frame, in contiguous chunks of frames across the pool
+    ThreadPool::global().parallel_for(numFrames, note_min_frames_per_chunk, [&](std::size_t begin, std::size_t end) {
+        SpectrumStage stage;
+
+        // Prime the rolling buffer with the frame preceding the chunk
+        if (begin > 0) {
+            stage.analyse(samples.data() + (begin - 1) * note_hop_size, window);
+            std::swap(stage.magnitudes[0], stage.magnitudes[1]);
+        }
+
+        for (std::size_t n = begin; n < end; ++n) {
+            std::size_t peak = stage.analyse(samples.data() + n * note_hop_size, window);
+
+            // 2a) spectral flux
+            if (n > 0) {
+                const auto& current = stage.magnitudes[0];
+                const auto& previous = stage.magnitudes[1];
+                float sum = 0;
+                for (std::size_t k = 0; k < note_bin_count; ++k) {
+                    sum += std::max(current[k] - previous[k], 0.0f);
+                }
+                flux[n] = sum;
             }
-            flux[n] = sum;
+
+            // 2b) peak-bin pitch
+            pitches[n] = (peak * sample_rate) / float(note_frame_size);
+
+            std::swap(stage.magnitudes[0], stage.magnitudes[1]);
         }
-        // 2d) peak-bin pitch
-        std::size_t peak = std::max_element(
-            spectra[n].begin(),
-            spectra[n].begin() + frameSize/2,
-            [](auto &a, auto &b){ return std::abs(a) < std::abs(b); }
-        ) - spectra[n].begin();
-        pitches[n] = (peak * sample_rate) / float(frameSize);
-    }
+    });
 
     // 3) Find onsets
     float meanFlux = std::accumulate(flux.begin(), flux.end(), 0.0f) / numFrames;
@@ -95,16 +236,15 @@ std::vector<DetectedNote> detectNotes(const std::vector<float> &samples, int sam
 
     // 4) Build notes
     std::vector<DetectedNote> notes;
+    notes.reserve(onsets.size());
+    std::vector<float> blockPitches;
     for (std::size_t idx = 0; idx + 1 < onsets.size(); ++idx) {
         std::size_t i = onsets[idx], j = onsets[idx+1];
-        uint64_t start = i * hopSize;
-        uint64_t dur   = (j - i) * hopSize;
+        uint64_t start = i * note_hop_size;
+        uint64_t dur   = (j - i) * note_hop_size;
 
         // e.g. median pitch in [i..j)
-        std::vector<float> blockPitches(
-            pitches.begin() + i,
-            pitches.begin() + j
-        );
+        blockPitches.assign(pitches.begin() + i, pitches.begin() + j);
         std::nth_element(
             blockPitches.begin(),
             blockPitches.begin() + blockPitches.size()/2,
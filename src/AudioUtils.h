@@ -5,6 +5,7 @@
 #ifndef AUDIOUTILS_H
 #define AUDIOUTILS_H
 #include <cstdint>
+#include <span>
 #include <vector>
 
 
@@ -14,8 +15,15 @@ struct DetectedNote {
     float frequency;
 };
 
-std::vector<float> compute_envelope(const std::vector<float>& samples, int sample_rate, float window_ms);
-std::vector<DetectedNote> detectNotes(const std::vector<float>& samples, int sample_rate);
+std::vector<float> compute_envelope(std::span<const float> samples, int sample_rate, float window_ms);
+
+// Append to `envelope` the values whose window is fully inside `samples`, at most `max_count` of them.
+// `samples` may still be growing: values near its end are only produced once `is_complete` is set.
+// Gives the same result as compute_envelope once everything is appended
+void extend_envelope(std::span<const float> samples, bool is_complete, int sample_rate, float window_ms,
+                     std::vector<float>& envelope, std::size_t max_count);
+
+std::vector<DetectedNote> detectNotes(std::span<const float> samples, int sample_rate);
 float hann(std::size_t n, std::size_t N);
 
 
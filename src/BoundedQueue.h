@@ -0,0 +1,77 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+
+// Blocking FIFO between two pipeline stages. A full queue blocks the producer, so a fast stage
+// can only run `capacity` items ahead of the next one and memory stays bounded.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity == 0 ? 1 : capacity) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Block while the queue is full. Return false if the queue was closed, the value is dropped
+    bool push(T value) {
+        std::unique_lock lock(mutex);
+        not_full.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) return false;
+
+        items.push_back(std::move(value));
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Block while the queue is empty. Return nullopt once the queue is closed and drained
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex);
+        not_empty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) return std::nullopt;
+
+        T value = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return value;
+    }
+
+    // Wake every waiting thread. Pending items can still be popped, pushes fail
+    void close() {
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+        }
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+    bool isClosed() const {
+        std::lock_guard lock(mutex);
+        return closed;
+    }
+
+private:
+    const std::size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
+
+
+
+#endif //BOUNDEDQUEUE_H
@@ -0,0 +1,93 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "CommandStore.h"
+
+#include <atomic>
+
+namespace {
+    const CommandStore::Commands no_commands;
+
+    // Copies only ever appear on the editing thread, so a count of 1 means nobody else can see the object.
+    // The fence orders our writes after the reads of the thread that dropped the last copy
+    template<typename T>
+    T& detach(std::shared_ptr<const T>& pointer) {
+        if (!pointer) pointer = std::make_shared<T>();
+        else if (pointer.use_count() > 1) pointer = std::make_shared<T>(*pointer);
+        else std::atomic_thread_fence(std::memory_order_acquire);
+
+        // Every object is created non-const above, casting the constness away is fine
+        return const_cast<T&>(*pointer);
+    }
+}
+
+CommandStore::CommandStore() : shards(std::make_shared<Shards>()) {}
+
+void CommandStore::assign(const std::unordered_map<int64_t, Commands> &commands) {
+    std::array<Shard, shard_count> new_shards;
+    for (auto& [uuid, list] : commands) new_shards[shardOf(uuid)][uuid] = std::make_shared<Commands>(list);
+
+    shards = std::make_shared<Shards>();
+    for (size_t i = 0; i < shard_count; ++i) {
+        if (!new_shards[i].empty()) (*shards)[i] = std::make_shared<Shard>(std::move(new_shards[i]));
+    }
+}
+
+void CommandStore::clear() {
+    shards = std::make_shared<Shards>();
+}
+
+const CommandStore::Commands & CommandStore::at(int64_t uuid) const {
+    auto shard = findShard(uuid);
+    if (!shard) return no_commands;
+
+    auto found = shard->find(uuid);
+    return found == shard->end() ? no_commands : *found->second;
+}
+
+bool CommandStore::contains(int64_t uuid) const {
+    auto shard = findShard(uuid);
+    return shard && shard->contains(uuid);
+}
+
+CommandStore::Commands & CommandStore::edit(int64_t uuid) {
+    return detach(editShard(uuid)[uuid]);
+}
+
+void CommandStore::erase(int64_t uuid) {
+    if (contains(uuid)) editShard(uuid).erase(uuid);
+}
+
+std::shared_ptr<const CommandStore::Commands> CommandStore::share(int64_t uuid) const {
+    auto shard = findShard(uuid);
+    if (!shard) return nullptr;
+
+    auto found = shard->find(uuid);
+    return found == shard->end() ? nullptr : found->second;
+}
+
+void CommandStore::restore(int64_t uuid, std::shared_ptr<const Commands> list) {
+    if (!list) erase(uuid);
+    else editShard(uuid)[uuid] = std::move(list);
+}
+
+std::unordered_map<int64_t, CommandStore::Commands> CommandStore::toMap() const {
+    std::unordered_map<int64_t, Commands> result;
+    for (auto& shard : *shards) {
+        if (!shard) continue;
+        for (auto& [uuid, list] : *shard) result.emplace(uuid, *list);
+    }
+    return result;
+}
+
+const CommandStore::Shard * CommandStore::findShard(int64_t uuid) const {
+    return (*shards)[shardOf(uuid)].get();
+}
+
+CommandStore::Shard & CommandStore::editShard(int64_t uuid) {
+    if (shards.use_count() > 1) shards = std::make_shared<Shards>(*shards);
+    else std::atomic_thread_fence(std::memory_order_acquire);
+
+    return detach((*shards)[shardOf(uuid)]);
+}
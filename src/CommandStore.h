@@ -0,0 +1,63 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef COMMANDSTORE_H
+#define COMMANDSTORE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "LightManager.h"
+
+// Commands of every keyframe, as a persistent structure: copying a store only copies a pointer, and the
+// copies share everything until one of them is edited. An edit then clones the shard table (256 pointers),
+// the shard holding the keyframe and its command list, the rest of the show stays shared.
+// A copy is a snapshot safe to read from another thread, as long as that thread does not edit it.
+class CommandStore {
+public:
+    using Commands = std::vector<Command>;
+
+    CommandStore();
+
+    void assign(const std::unordered_map<int64_t, Commands>& commands);
+    void clear();
+
+    // Empty list if the keyframe has no command
+    const Commands& at(int64_t uuid) const;
+    bool contains(int64_t uuid) const;
+
+    // Mutable list of a keyframe, created if needed. Detach it from the copies sharing it
+    Commands& edit(int64_t uuid);
+    void erase(int64_t uuid);
+
+    // The list of a keyframe as an immutable value, nullptr if it has none. Holding it costs nothing, the
+    // store copies the list the next time it is edited
+    std::shared_ptr<const Commands> share(int64_t uuid) const;
+    // Put back a list obtained from share(), nullptr erases the keyframe's list
+    void restore(int64_t uuid, std::shared_ptr<const Commands> list);
+
+    // Deep copy, for the serialisers
+    std::unordered_map<int64_t, Commands> toMap() const;
+
+private:
+    static constexpr size_t shard_count = 256;
+
+    using Shard = std::unordered_map<int64_t, std::shared_ptr<const Commands>>;
+    using Shards = std::array<std::shared_ptr<const Shard>, shard_count>;
+
+    // Uuids are handed out sequentially, a modulo spreads them evenly
+    static size_t shardOf(int64_t uuid) { return uint64_t(uuid) % shard_count; }
+
+    const Shard* findShard(int64_t uuid) const;
+    Shard& editShard(int64_t uuid);
+
+    std::shared_ptr<Shards> shards;
+};
+
+
+
+#endif //COMMANDSTORE_H
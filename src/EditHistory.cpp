@@ -0,0 +1,342 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "EditHistory.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    using Commands = CommandStore::Commands;
+
+    std::vector<int> groupsOf(const Commands& commands) {
+        std::vector<int> groups;
+        for (auto& command : commands) groups.push_back(command.group_id);
+        return groups;
+    }
+
+    // Insertion of a keyframe, or its deletion when `is_insertion` is false.
+    // The command list is shared with the store rather than copied
+    class KeyframeExistenceEdit : public EditHistory::Edit {
+    public:
+        KeyframeExistenceEdit(const Keyframe& keyframe, std::shared_ptr<const Commands> commands, bool is_insertion)
+            : keyframe(keyframe), commands(std::move(commands)), is_insertion(is_insertion) {}
+
+        void redo(EditHistory& history) override { is_insertion ? add(history) : remove(history); }
+        void undo(EditHistory& history) override { is_insertion ? remove(history) : add(history); }
+
+        size_t size() const override {
+            return sizeof(*this) + (commands ? commands->size() * sizeof(Command) : 0);
+        }
+
+    private:
+        void add(EditHistory& history) {
+            history.keyframes.insert(keyframe);
+            history.commands.restore(keyframe.uuid, commands);
+            history.invalidateKeyframe(keyframe.trigger_sample, keyframe.uuid);
+        }
+
+        void remove(EditHistory& history) {
+            // Keep the latest state, the keyframe comes back exactly as it left
+            keyframe = history.keyframes.at(keyframe.uuid);
+            commands = history.commands.share(keyframe.uuid);
+
+            history.keyframes.erase(keyframe.uuid);
+            history.commands.erase(keyframe.uuid);
+            history.invalidate(keyframe.trigger_sample, commands ? groupsOf(*commands) : std::vector<int>{});
+        }
+
+        Keyframe keyframe;
+        std::shared_ptr<const Commands> commands;
+        bool is_insertion;
+    };
+
+    class KeyframeMoveEdit : public EditHistory::Edit {
+    public:
+        KeyframeMoveEdit(int64_t uuid, int64_t from, int64_t to) : uuid(uuid), from(from), to(to) {}
+
+        void redo(EditHistory& history) override { move(history, from, to); }
+        void undo(EditHistory& history) override { move(history, to, from); }
+
+        // A drag moves the same keyframe a little every frame
+        bool canMerge(const Edit& next) const override {
+            auto move = dynamic_cast<const KeyframeMoveEdit*>(&next);
+            return move && move->uuid == uuid && move->from == to;
+        }
+
+        void merge(const Edit& next) override {
+            to = static_cast<const KeyframeMoveEdit&>(next).to;
+        }
+
+        size_t size() const override { return sizeof(*this); }
+
+    private:
+        void move(EditHistory& history, int64_t old_sample, int64_t new_sample) {
+            history.keyframes.move(uuid, new_sample);
+            if (history.commands.contains(uuid)) {
+                for (auto& command : history.commands.edit(uuid)) retimeCommand(command, new_sample);
+            }
+
+            // Only the sample the keyframe left and the one it landed on changed
+            auto groups = groupsOf(history.commands.at(uuid));
+            history.invalidate(old_sample, groups);
+            history.invalidate(new_sample, groups);
+        }
+
+        int64_t uuid;
+        int64_t from;
+        int64_t to;
+    };
+
+    class KeyframeFlagsEdit : public EditHistory::Edit {
+    public:
+        KeyframeFlagsEdit(int64_t uuid, const Keyframe& before, bool is_locked, bool is_enabled)
+            : uuid(uuid), is_locked{before.is_locked, is_locked}, is_enabled{before.is_enabled, is_enabled} {}
+
+        void redo(EditHistory& history) override { apply(history, 1); }
+        void undo(EditHistory& history) override { apply(history, 0); }
+
+        size_t size() const override { return sizeof(*this); }
+
+    private:
+        void apply(EditHistory& history, int state) {
+            auto& keyframe = history.keyframes.at(uuid);
+            bool was_enabled = keyframe.is_enabled;
+
+            keyframe.is_locked = is_locked[state];
+            keyframe.is_enabled = is_enabled[state];
+
+            // Locking does not change the show
+            if (was_enabled != keyframe.is_enabled) history.invalidateKeyframe(keyframe.trigger_sample, uuid);
+        }
+
+        int64_t uuid;
+        bool is_locked[2];  // Before, after
+        bool is_enabled[2];
+    };
+
+    // Insertion of a command in a keyframe, or its deletion when `is_insertion` is false
+    class CommandExistenceEdit : public EditHistory::Edit {
+    public:
+        CommandExistenceEdit(int64_t uuid, size_t index, const Command& command, bool is_insertion)
+            : uuid(uuid), index(index), command(command), is_insertion(is_insertion) {}
+
+        void redo(EditHistory& history) override { is_insertion ? add(history) : remove(history); }
+        void undo(EditHistory& history) override { is_insertion ? remove(history) : add(history); }
+
+        size_t size() const override { return sizeof(*this); }
+
+    private:
+        void add(EditHistory& history) {
+            auto& commands = history.commands.edit(uuid);
+            commands.insert(commands.begin() + index, command);
+            history.invalidateKeyframe(history.keyframes.at(uuid).trigger_sample, uuid);
+        }
+
+        void remove(EditHistory& history) {
+            auto& commands = history.commands.edit(uuid);
+            command = commands.at(index);
+            commands.erase(commands.begin() + index);
+
+            // The removed command's group must be recomputed too
+            history.invalidateKeyframe(history.keyframes.at(uuid).trigger_sample, uuid, command.group_id);
+        }
+
+        int64_t uuid;
+        size_t index;
+        Command command;
+        bool is_insertion;
+    };
+
+    class CommandChangeEdit : public EditHistory::Edit {
+    public:
+        CommandChangeEdit(int64_t uuid, size_t index, const Command& before, const Command& after)
+            : uuid(uuid), index(index), before(before), after(after) {}
+
+        void redo(EditHistory& history) override { apply(history, before, after); }
+        void undo(EditHistory& history) override { apply(history, after, before); }
+
+        // Dragging a slider changes the same command every frame
+        bool canMerge(const Edit& next) const override {
+            auto change = dynamic_cast<const CommandChangeEdit*>(&next);
+            return change && change->uuid == uuid && change->index == index;
+        }
+
+        void merge(const Edit& next) override {
+            after = static_cast<const CommandChangeEdit&>(next).after;
+        }
+
+        size_t size() const override { return sizeof(*this); }
+
+    private:
+        void apply(EditHistory& history, const Command& old_value, const Command& new_value) {
+            history.commands.edit(uuid).at(index) = new_value;
+            history.invalidate(history.keyframes.at(uuid).trigger_sample, {old_value.group_id, new_value.group_id});
+        }
+
+        int64_t uuid;
+        size_t index;
+        Command before;
+        Command after;
+    };
+}
+
+EditHistory::EditHistory(KeyframeStore &keyframes, CommandStore &commands, size_t memory_budget)
+    : keyframes(keyframes), commands(commands), memory_budget(memory_budget) {}
+
+void EditHistory::beginStep() {
+    open_depth++;
+}
+
+void EditHistory::endStep() {
+    if (open_depth == 0 || --open_depth > 0) return;
+    if (!open_step.edits.empty()) push(std::exchange(open_step, {}));
+}
+
+void EditHistory::seal() {
+    is_sealed = true;
+}
+
+void EditHistory::insertKeyframe(const Keyframe &keyframe, const CommandStore::Commands &commands) {
+    perform(std::make_unique<KeyframeExistenceEdit>(keyframe, std::make_shared<Commands>(commands), true));
+}
+
+void EditHistory::eraseKeyframe(int64_t uuid) {
+    if (!keyframes.contains(uuid)) return;
+    perform(std::make_unique<KeyframeExistenceEdit>(keyframes.at(uuid), nullptr, false));
+}
+
+void EditHistory::moveKeyframe(int64_t uuid, int64_t trigger_sample) {
+    auto old_sample = keyframes.at(uuid).trigger_sample;
+    if (old_sample == trigger_sample) return;
+    perform(std::make_unique<KeyframeMoveEdit>(uuid, old_sample, trigger_sample));
+}
+
+void EditHistory::setKeyframeFlags(int64_t uuid, bool is_locked, bool is_enabled) {
+    auto& keyframe = keyframes.at(uuid);
+    if (keyframe.is_locked == is_locked && keyframe.is_enabled == is_enabled) return;
+    perform(std::make_unique<KeyframeFlagsEdit>(uuid, keyframe, is_locked, is_enabled));
+}
+
+void EditHistory::insertCommand(int64_t uuid, size_t index, const Command &command) {
+    index = std::min(index, commands.at(uuid).size());
+    perform(std::make_unique<CommandExistenceEdit>(uuid, index, command, true));
+}
+
+void EditHistory::eraseCommand(int64_t uuid, size_t index) {
+    if (index >= commands.at(uuid).size()) return;
+    perform(std::make_unique<CommandExistenceEdit>(uuid, index, commands.at(uuid)[index], false));
+}
+
+void EditHistory::setCommand(int64_t uuid, size_t index, const Command &command) {
+    auto& before = commands.at(uuid).at(index);
+    if (before == command) return;
+    perform(std::make_unique<CommandChangeEdit>(uuid, index, before, command));
+}
+
+bool EditHistory::canUndo() const {
+    return !undo_steps.empty();
+}
+
+bool EditHistory::canRedo() const {
+    return !redo_steps.empty();
+}
+
+bool EditHistory::undo() {
+    if (undo_steps.empty()) return false;
+
+    auto step = std::move(undo_steps.back());
+    undo_steps.pop_back();
+    for (auto it = step.edits.rbegin(); it != step.edits.rend(); ++it) (*it)->undo(*this);
+
+    redo_steps.push_back(std::move(step));
+    is_sealed = true;
+    return true;
+}
+
+bool EditHistory::redo() {
+    if (redo_steps.empty()) return false;
+
+    auto step = std::move(redo_steps.back());
+    redo_steps.pop_back();
+    for (auto& edit : step.edits) edit->redo(*this);
+
+    undo_steps.push_back(std::move(step));
+    is_sealed = true;
+    return true;
+}
+
+void EditHistory::clear() {
+    undo_steps.clear();
+    redo_steps.clear();
+    open_step = {};
+    open_depth = 0;
+    memory_usage = 0;
+    is_sealed = true;
+}
+
+size_t EditHistory::memoryUsage() const {
+    return memory_usage;
+}
+
+void EditHistory::invalidate(int64_t sample, const std::vector<int> &groups) const {
+    if (invalidate_callback) invalidate_callback(sample, groups);
+}
+
+void EditHistory::invalidateKeyframe(int64_t sample, int64_t uuid, int extra_group) const {
+    auto groups = groupsOf(commands.at(uuid));
+    if (extra_group >= 0) groups.push_back(extra_group);
+    invalidate(sample, groups);
+}
+
+void EditHistory::perform(std::unique_ptr<Edit> edit) {
+    edit->redo(*this);
+
+    if (open_depth > 0) open_step.edits.push_back(std::move(edit));
+    else {
+        Step step;
+        step.edits.push_back(std::move(edit));
+        push(std::move(step));
+    }
+}
+
+void EditHistory::push(Step step) {
+    // A new edit forks the history, what was undone can no longer be redone
+    for (auto& undone : redo_steps) memory_usage -= undone.size;
+    redo_steps.clear();
+
+    if (canMerge(step)) {
+        auto& last = undo_steps.back();
+        for (size_t i = 0; i < step.edits.size(); ++i) last.edits[i]->merge(*step.edits[i]);
+    } else {
+        step.size = measure(step);
+        memory_usage += step.size;
+        undo_steps.push_back(std::move(step));
+    }
+    is_sealed = false;
+
+    // Forget the oldest steps once over budget, always keep the last one
+    while (memory_usage > memory_budget && undo_steps.size() > 1) {
+        memory_usage -= undo_steps.front().size;
+        undo_steps.pop_front();
+    }
+}
+
+bool EditHistory::canMerge(const Step &step) const {
+    if (is_sealed || undo_steps.empty()) return false;
+
+    auto& last = undo_steps.back().edits;
+    if (last.size() != step.edits.size()) return false;
+
+    for (size_t i = 0; i < last.size(); ++i) {
+        if (!last[i]->canMerge(*step.edits[i])) return false;
+    }
+    return true;
+}
+
+size_t EditHistory::measure(const Step &step) {
+    size_t size = sizeof(Step) + step.edits.capacity() * sizeof(std::unique_ptr<Edit>);
+    for (auto& edit : step.edits) size += edit->size();
+    return size;
+}
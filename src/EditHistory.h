@@ -0,0 +1,93 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef EDITHISTORY_H
+#define EDITHISTORY_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "CommandStore.h"
+#include "KeyframeStore.h"
+
+// Undo / redo of the keyframe and command edits.
+// Every edit goes through this class: it is applied to the stores and recorded as a small delta that knows
+// how to revert itself (a move keeps two samples, a command change the command before and after).
+// Undoing replays the inverse deltas and reports the touched samples to invalidate_callback, so the timeline
+// is patched in place like for any other edit.
+class EditHistory {
+public:
+    struct Edit {
+        virtual ~Edit() = default;
+        virtual void redo(EditHistory& history) = 0;
+        virtual void undo(EditHistory& history) = 0;
+        // Whether the given next edit continues the same gesture, merge() then folds it into this edit
+        virtual bool canMerge(const Edit&) const { return false; }
+        virtual void merge(const Edit&) {}
+        // Approximate heap footprint, counted against the memory budget
+        virtual size_t size() const = 0;
+    };
+
+    // Samples whose commands changed, with the groups to recompute there
+    std::function<void(int64_t sample, const std::vector<int>& groups)> invalidate_callback = nullptr;
+
+    EditHistory(KeyframeStore& keyframes, CommandStore& commands, size_t memory_budget = 8 << 20);
+
+    // Edits made between begin and end are undone together. Calls nest
+    void beginStep();
+    void endStep();
+    // The next step starts a new entry instead of extending the last one. Call it when a gesture ends
+    void seal();
+
+    void insertKeyframe(const Keyframe& keyframe, const CommandStore::Commands& commands);
+    void eraseKeyframe(int64_t uuid);
+    void moveKeyframe(int64_t uuid, int64_t trigger_sample);
+    void setKeyframeFlags(int64_t uuid, bool is_locked, bool is_enabled);
+
+    void insertCommand(int64_t uuid, size_t index, const Command& command);
+    void eraseCommand(int64_t uuid, size_t index);
+    void setCommand(int64_t uuid, size_t index, const Command& command);
+
+    bool canUndo() const;
+    bool canRedo() const;
+    // Return false if there was nothing to undo / redo
+    bool undo();
+    bool redo();
+
+    void clear();
+    size_t memoryUsage() const;
+
+    // Used by the edits
+    KeyframeStore& keyframes;
+    CommandStore& commands;
+    void invalidate(int64_t sample, const std::vector<int>& groups) const;
+    void invalidateKeyframe(int64_t sample, int64_t uuid, int extra_group = -1) const;
+
+private:
+    struct Step {
+        std::vector<std::unique_ptr<Edit>> edits;
+        size_t size = 0; // Measured when recorded
+    };
+
+    void perform(std::unique_ptr<Edit> edit);
+    void push(Step step);
+    bool canMerge(const Step& step) const;
+    static size_t measure(const Step& step);
+
+    std::deque<Step> undo_steps;
+    std::deque<Step> redo_steps;
+    size_t memory_usage = 0;
+    size_t memory_budget;
+
+    Step open_step;
+    int open_depth = 0;
+    bool is_sealed = true;
+};
+
+
+
+#endif //EDITHISTORY_H
@@ -104,11 +104,16 @@ bool EliseApp::init() {
     waveform_viewer.keyframe_selection_callback     = [this](int arg){keyframe_selection_callback(arg);};
     waveform_viewer.reset_selection_callback        = [this](){reset_selection_callback();};
     waveform_viewer.keyframe_unselection_callback   = [this](int arg){keyframe_unselection_callback(arg);};
+    waveform_viewer.cursor_scrub_callback           = [this](int64_t arg){cursor_scrub_callback(arg);};
+    waveform_viewer.set_keyframes(&keyframes);
+
+    edit_history.invalidate_callback = [this](int64_t sample, const std::vector<int>& groups){invalidate_range(sample, sample, groups);};
 
     init_groups();
     init_light_manager();
 
     renderer.InitRenderer(1000, 500);
+    renderer.setFixtures(fixtures);
 
     return true;
 }
@@ -148,11 +153,7 @@ void EliseApp::mainloop() {
         }
         glfwSwapBuffers(window);
 
-        if (is_exporting) {
-            for (int i = 0; i < 5; ++i) {
-                update_export();
-            }
-        }
+        if (is_exporting) update_export();
 
     }
 }
@@ -201,12 +202,18 @@ void EliseApp::init_groups() {
 
     char buff[128];
 
+    std::vector<size_t> all;
     for (size_t i = 0; i < light_count; ++i) {
-        sprintf(buff, "Light %d", i + 1);
+        sprintf(buff, "Light %d", int(i + 1));
         new_group(buff, {i});
+        all.push_back(i);
     }
 
-    new_group("All", {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11});
+    new_group("All", all);
+
+    // Shapes only make sense on the default 12 windows rig
+    if (fixtures != defaultFixtureLayout()) return;
+
     new_group("Up", {0, 1, 2, 3, 4});
     new_group("Vertical Mid", {5, 6});
     new_group("Down", {7, 8, 9, 10, 11});
@@ -224,6 +231,8 @@ void EliseApp::init_groups() {
 }
 
 void EliseApp::init_light_manager() {
+    light_manager.clear();
+
     for (int i = 0; i < light_count; ++i) {
         light_manager.addLight();
     }
@@ -240,21 +249,18 @@ void EliseApp::init_light_manager() {
 void EliseApp::compile_commands() {
     std::vector<Command> commands;
 
-    order_keyframes();
-
-    for (auto & keyframe: keyframes) {
-        for (auto & command: keyframe_uuid_to_commands[keyframe.uuid]) {
+    for (auto & [key, keyframe]: keyframes) {
+        if (!keyframe.is_enabled) continue;
 
+        for (auto command: keyframe_uuid_to_commands.at(keyframe.uuid)) {
             retimeCommand(command, keyframe.trigger_sample);
-
-            if (keyframe.is_enabled) commands.push_back(command);
+            commands.push_back(command);
         }
     }
 
-    std::reverse(commands.begin(), commands.end());
-
     light_manager.reset();
-    light_manager.setCommandStack(commands);
+    light_manager.compile(commands);
+    is_timeline_dirty = false;
 }
 
 void EliseApp::draw() {
@@ -320,8 +326,7 @@ void EliseApp::draw_export_pop_up() {
 
     ImGui::Begin("Export popup", nullptr, popup_flag);
     ImGui::Text("Exporting :");
-    float progress = float(current_frame) / float(max_frame);
-    ImGui::ProgressBar(progress);
+    ImGui::ProgressBar(exporter ? exporter->getProgress() : 1.f);
     ImGui::End();
 
     ImGui::PopStyleColor();
@@ -338,10 +343,21 @@ void EliseApp::draw_menu_bar() {
             if (ImGui::MenuItem("Save as")) on_save_as();
             ImGui::Separator();
             if (ImGui::MenuItem("Export script")) on_export();
-            if (ImGui::MenuItem("Export video")) on_export_video();
+            if (ImGui::MenuItem("Export JSON")) on_export_json();
+            if (ImGui::BeginMenu("Export video")) {
+                if (ImGui::MenuItem("Draft")) on_export_video(ExportPreset::draft);
+                if (ImGui::MenuItem("Master")) on_export_video(ExportPreset::master);
+                if (ImGui::MenuItem("Lossless (MKV)")) on_export_video(ExportPreset::lossless);
+                ImGui::EndMenu();
+            }
 
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Edit")) {
+            if (ImGui::MenuItem("Undo", "Ctrl-Z", false, edit_history.canUndo())) undo_edit();
+            if (ImGui::MenuItem("Redo", "Ctrl-Shift-Z", false, edit_history.canRedo())) redo_edit();
+            ImGui::EndMenu();
+        }
         if (ImGui::BeginMenu("Window")) {
             ImGui::MenuItem("Project Manager", nullptr, &is_project_manager_visible);
             ImGui::MenuItem("Keyframe Edition", nullptr, &is_keyframe_edition_window_visible);
@@ -377,10 +393,10 @@ void EliseApp::draw_player() {
         ImGui::Text("Playback option");
         ImGui::Separator();
 
-        if ( ImGui::DragFloat("Speed", &playback_speed, 0.01f, 0.1f, 10.0f) && audio_manager.isPlaying()) {
-            stop_audio();
-            play_audio();
+        if ( ImGui::DragFloat("Speed", &playback_speed, 0.01f, 0.1f, 10.0f)) {
+            audio_manager.setSpeed(playback_speed);
         }
+        ImGui::Checkbox("Scrub audio", &is_scrub_audio_enabled);
 
         ImGui::Spacing();
         ImGui::Separator();
@@ -403,14 +419,7 @@ void EliseApp::draw_viewport() {
     }
     renderer.setViewport(m_width, m_height);
 
-    auto& colors = light_manager.getLightStates();
-    std::array<glm::vec4, 12> arr_colors;
-    for (int i = 0; i < 12; ++i) {
-        auto& color = colors[i];
-        arr_colors.at(i) = {color.r / 255.f, color.g / 255.f, color.b / 255.f, color.a / 255.f};
-    }
-
-    if (!is_exporting) renderer.Render(arr_colors);
+    if (!is_exporting) renderer.Render(light_manager.getLightColors());
 
     ImGui::Image(renderer.GetTexture(), ImVec2((float)m_width, (float)m_height), ImVec2(0, 1), ImVec2(1, 0));
     ImGui::End();
@@ -436,7 +445,7 @@ void EliseApp::draw_keyframe_edition_window() {
             int are_locked = -1; // -1: start value, 0: all locked, 1: all unlocked, 2: mixed
             int are_enabled = -1; // -1: start value, 0: all enabled, 1: all disabled, 2: mixed
             for (int64_t selected_keyframe: selected_keyframes) {
-                auto& keyframe = keyframes[keyframe_uuid_to_index[selected_keyframe]];
+                auto& keyframe = keyframes.at(selected_keyframe);
 
                 if (keyframe.is_locked) {
                     if (are_locked == -1 || are_locked == 0) are_locked = 0;
@@ -459,22 +468,26 @@ void EliseApp::draw_keyframe_edition_window() {
             {
                 if (ImGui::Button((const char*)u8"\uf023"))
                 {
+                    edit_history.beginStep();
                     for (int64_t selected_keyframe: selected_keyframes) {
-                        auto& keyframe = keyframes[keyframe_uuid_to_index[selected_keyframe]];
-                        keyframe.is_locked = false;
+                        auto& keyframe = keyframes.at(selected_keyframe);
+                        edit_history.setKeyframeFlags(selected_keyframe, false, keyframe.is_enabled);
                     }
-                    update_keyframes();
+                    edit_history.endStep();
+                    mark_project_modified();
                 }
             }
             else
             {
                 if (ImGui::Button((const char*)u8"\uf3c1"))
                 {
+                    edit_history.beginStep();
                     for (int64_t selected_keyframe: selected_keyframes) {
-                        auto& keyframe = keyframes[keyframe_uuid_to_index[selected_keyframe]];
-                        keyframe.is_locked = true;
+                        auto& keyframe = keyframes.at(selected_keyframe);
+                        edit_history.setKeyframeFlags(selected_keyframe, true, keyframe.is_enabled);
                     }
-                    update_keyframes();
+                    edit_history.endStep();
+                    mark_project_modified();
                 }
             }
 
@@ -482,11 +495,13 @@ void EliseApp::draw_keyframe_edition_window() {
 
             bool enabled = are_enabled == 0;
             if (ImGui::Checkbox("Enabled", &enabled)) {
+                edit_history.beginStep();
                 for (int64_t selected_keyframe: selected_keyframes) {
-                    auto& keyframe = keyframes[keyframe_uuid_to_index[selected_keyframe]];
-                    keyframe.is_enabled = enabled;
+                    auto& keyframe = keyframes.at(selected_keyframe);
+                    edit_history.setKeyframeFlags(selected_keyframe, keyframe.is_locked, enabled);
                 }
-                update_keyframes();
+                edit_history.endStep();
+                mark_project_modified();
             }
 
 
@@ -495,32 +510,34 @@ void EliseApp::draw_keyframe_edition_window() {
             std::vector<const char*> listbox_buff;
 
             auto selected_keyframe_uuid = *selected_keyframes.begin();
-            auto& keyframe = keyframes.at(keyframe_uuid_to_index.at(selected_keyframe_uuid));
-
-            auto& commands = keyframe_uuid_to_commands[selected_keyframe_uuid];
+            auto& keyframe = keyframes.at(selected_keyframe_uuid);
 
             // Draw a lock / unlock button
             if (keyframe.is_locked)
             {
                 if (ImGui::Button((const char*)u8"\uf023"))
                 {
-                    keyframe.is_locked = false;
-                    update_keyframes();
+                    edit_history.setKeyframeFlags(selected_keyframe_uuid, false, keyframe.is_enabled);
+                    mark_project_modified();
                 }
             }
             else
             {
                 if (ImGui::Button((const char*)u8"\uf3c1"))
                 {
-                    keyframe.is_locked = true;
-                    update_keyframes();
+                    edit_history.setKeyframeFlags(selected_keyframe_uuid, true, keyframe.is_enabled);
+                    mark_project_modified();
                 }
             }
 
             ImGui::SameLine();
-            if (ImGui::Checkbox("Enabled", &keyframe.is_enabled)) update_keyframes();
+            bool is_enabled = keyframe.is_enabled;
+            if (ImGui::Checkbox("Enabled", &is_enabled)) {
+                edit_history.setKeyframeFlags(selected_keyframe_uuid, keyframe.is_locked, is_enabled);
+                mark_project_modified();
+            }
 
-            for (auto & command: keyframe_uuid_to_commands[selected_keyframe_uuid]) {
+            for (auto & command: keyframe_uuid_to_commands.at(selected_keyframe_uuid)) {
                 commands_str.push_back("Command on group " + groups[command.group_id].name);
                 listbox_buff.push_back(commands_str.back().c_str());
             }
@@ -530,14 +547,16 @@ void EliseApp::draw_keyframe_edition_window() {
 
 
             if (ImGui::Button("Add")) {
-                commands.push_back(Command{});
+                edit_history.insertCommand(selected_keyframe_uuid, keyframe_uuid_to_commands.at(selected_keyframe_uuid).size(), Command{});
+                mark_project_modified();
             }
 
             ImGui::SameLine();
 
-            ImGui::BeginDisabled(selected_command < 0 || selected_command >= commands.size());
+            ImGui::BeginDisabled(selected_command < 0 || selected_command >= keyframe_uuid_to_commands.at(selected_keyframe_uuid).size());
             if (ImGui::Button("Delete")) {
-                commands.erase(commands.begin() + selected_command);
+                edit_history.eraseCommand(selected_keyframe_uuid, selected_command);
+                mark_project_modified();
             }
 
             ImGui::EndDisabled();
@@ -558,11 +577,19 @@ void EliseApp::draw_command_edition_window() {
             ImGui::BeginDisabled();
             ImGui::Text("Multiple keyframes selected");
             ImGui::EndDisabled();
+        } else if (selected_command < 0 || selected_command >= keyframe_uuid_to_commands.at(*selected_keyframes.begin()).size()) {
+            ImGui::BeginDisabled();
+            ImGui::Text("No command selected");
+            ImGui::EndDisabled();
         } else {
             ImGui::Spacing();
             auto selected_keyframe_uuid = *selected_keyframes.begin();
-            auto& command = keyframe_uuid_to_commands[selected_keyframe_uuid][selected_command];
-            auto& keyframe = keyframes.at(keyframe_uuid_to_index[selected_keyframe_uuid]);
+            // Edit a copy, the store is only written (and detached from the snapshots) when something changed
+            Command command = keyframe_uuid_to_commands.at(selected_keyframe_uuid)[selected_command];
+            auto& keyframe = keyframes.at(selected_keyframe_uuid);
+
+            // Any change made below is recorded as one edit, which only invalidates this command's trigger sample
+            const Command command_before_edition = command;
 
             ImGui::Text("Command %d", selected_command);
 
@@ -683,6 +710,11 @@ void EliseApp::draw_command_edition_window() {
                     break;
                 }
             }
+
+            if (!(command == command_before_edition)) {
+                edit_history.setCommand(selected_keyframe_uuid, selected_command, command);
+                mark_project_modified();
+            }
         }
     }
 
@@ -702,10 +734,22 @@ void EliseApp::handle_input() {
         if (is_loaded_from_file) on_save();
         else on_save_as();
     }
+
+    // Text fields have their own undo
+    if (!ImGui::GetIO().WantTextInput && ImGui::IsKeyDown(ImGuiKey_ModCtrl)) {
+        bool is_shift_down = ImGui::IsKeyDown(ImGuiKey_ModShift);
+        if (ImGui::IsKeyPressed(ImGuiKey_Z)) is_shift_down ? redo_edit() : undo_edit();
+        else if (ImGui::IsKeyPressed(ImGuiKey_Y)) redo_edit();
+    }
 }
 
 void EliseApp::update() {
+    update_project_saver();
     if (is_exporting) return;
+
+    // A released mouse ends the current drag, the next edit starts a new undo step
+    if (!ImGui::IsMouseDown(ImGuiMouseButton_Left)) edit_history.seal();
+
     update_dialogs();
     handle_input();
     update_waveform_viewer();
@@ -716,20 +760,26 @@ void EliseApp::update() {
 
 void EliseApp::update_waveform_viewer() {
     if (audio_manager.isPlaying()) {
-        auto pos = audio_manager.getPlayheadPosition();
+        auto pos = audio_manager.getHeardPosition(get_frame_display_time());
         waveform_viewer.set_cursor_position(pos);
     }
 }
 
 void EliseApp::update_light_manager() {
     if (audio_manager.isPlaying() && !is_exporting) {
-        auto pos = audio_manager.getPlayheadPosition();
+        auto pos = audio_manager.getHeardPosition(get_frame_display_time());
         light_manager.update(pos);
     }
 }
 
+AudioClock::clock::time_point EliseApp::get_frame_display_time() const {
+    // With vsync the frame being built is shown at the next refresh, light it for that moment
+    return AudioClock::clock::now() + std::chrono::duration_cast<AudioClock::clock::duration>(
+        std::chrono::duration<double>(1.0 / target_application_framerate));
+}
+
 void EliseApp::play_audio() {
-    compile_commands();
+    if (is_timeline_dirty) compile_commands();
     audio_manager.play(int64_t(waveform_viewer.get_cursor_position()), playback_speed);
 }
 
@@ -737,28 +787,31 @@ void EliseApp::stop_audio() {
     audio_manager.stop();
 }
 
-void EliseApp::order_keyframes() {
-    std::sort(keyframes.begin(), keyframes.end(), compare);
-    build_keyframe_uuid_to_index_map();
-}
+void EliseApp::invalidate_range(int64_t from, int64_t to, const std::vector<int> &groups) {
+    // The next play recompiles everything anyway
+    if (is_timeline_dirty) return;
+
+    std::vector<Command> commands;
 
-void EliseApp::build_keyframe_uuid_to_index_map() {
-    keyframe_uuid_to_index.clear();
+    for (auto it = keyframes.lower_bound(from); it != keyframes.end() && it->second.trigger_sample <= to; ++it) {
+        auto& keyframe = it->second;
+        if (!keyframe.is_enabled) continue;
 
-    for (size_t i = 0; i < keyframes.size(); ++i) {
-        keyframe_uuid_to_index[keyframes[i].uuid] = i;
+        for (auto command: keyframe_uuid_to_commands.at(keyframe.uuid)) {
+            retimeCommand(command, keyframe.trigger_sample);
+            commands.push_back(command);
+        }
     }
+
+    light_manager.patch(from, to, groups, commands);
 }
 
 void EliseApp::keyframe_creation_callback(int64_t sample) {
     max_keyframe_uuid++;
-    keyframes.push_back(Keyframe{sample, max_keyframe_uuid});
-
-    // Create empty command
-    keyframe_uuid_to_commands[max_keyframe_uuid].push_back(Command{});
 
-    order_keyframes();
-    update_keyframes();
+    // With an empty command
+    edit_history.insertKeyframe(Keyframe{sample, max_keyframe_uuid}, {Command{}});
+    mark_project_modified();
 
     waveform_viewer.set_selected_keyframe(selected_keyframes);
     selected_keyframes.clear();
@@ -768,40 +821,47 @@ void EliseApp::keyframe_creation_callback(int64_t sample) {
 
 void EliseApp::keyframe_deletion_callback() {
 
-    // Build the list of index to delete
-    std::vector<int> to_delete;
-    to_delete.reserve(selected_keyframes.size());
-    for (int64_t selected_keyframe: selected_keyframes) {
-        to_delete.push_back(keyframe_uuid_to_index[selected_keyframe]);
-        keyframe_uuid_to_index.erase(selected_keyframe);
-    }
-    std::sort(to_delete.begin(), to_delete.end());
-    std::reverse(to_delete.begin(), to_delete.end());
-
-    for (int keyframe_index: to_delete) {
-        keyframes.erase(keyframes.begin() + keyframe_index);
-    }
+    edit_history.beginStep();
+    for (int64_t selected_keyframe: selected_keyframes) edit_history.eraseKeyframe(selected_keyframe);
+    edit_history.endStep();
 
-    build_keyframe_uuid_to_index_map();
-    update_keyframes();
+    if (!selected_keyframes.empty()) mark_project_modified();
     selected_keyframes.clear();
 }
 
 void EliseApp::keyframe_drag_callback(int64_t delta_sample) {
     // Check if one of the selected keyframe is locked
     for (int64_t selected_keyframe: selected_keyframes) {
-        if (keyframes.at(keyframe_uuid_to_index[selected_keyframe]).is_locked) return;
+        if (keyframes.at(selected_keyframe).is_locked) return;
     }
 
-    for (int64_t selected_keyframe: selected_keyframes) {
-        auto& keyframe = keyframes.at(keyframe_uuid_to_index[selected_keyframe]);
-        keyframe.trigger_sample += delta_sample;
+    if (delta_sample == 0) return;
 
-        for (auto& command : keyframe_uuid_to_commands[selected_keyframe]) { retimeCommand(command, keyframe.trigger_sample); }
+    // The frames of one drag are folded into a single undo step until the mouse is released
+    edit_history.beginStep();
+    for (int64_t selected_keyframe: selected_keyframes) {
+        edit_history.moveKeyframe(selected_keyframe, keyframes.at(selected_keyframe).trigger_sample + delta_sample);
     }
+    edit_history.endStep();
 
-    order_keyframes();
-    update_keyframes();
+    mark_project_modified();
+}
+
+void EliseApp::undo_edit() {
+    if (!edit_history.undo()) return;
+    prune_selection();
+    mark_project_modified();
+}
+
+void EliseApp::redo_edit() {
+    if (!edit_history.redo()) return;
+    prune_selection();
+    mark_project_modified();
+}
+
+void EliseApp::prune_selection() {
+    // Undoing a creation or redoing a deletion removes keyframes that may be selected
+    std::erase_if(selected_keyframes, [this](int64_t uuid) { return !keyframes.contains(uuid); });
 }
 
 void EliseApp::keyframe_selection_callback(int64_t keyframe_uuid) {
@@ -816,13 +876,15 @@ void EliseApp::keyframe_unselection_callback(int64_t keyframe_uuid) {
     selected_keyframes.erase(keyframe_uuid);
 }
 
-void EliseApp::update_keyframes() {
-    std::vector<Keyframe> waveform_keyframes;
-    waveform_keyframes.reserve(keyframes.size());
+void EliseApp::cursor_scrub_callback(int64_t sample) {
+    // While playing, the playhead drives the preview
+    if (audio_manager.isPlaying()) return;
 
-    for (auto& keyframe : keyframes) {waveform_keyframes.push_back({keyframe.trigger_sample, keyframe.uuid, keyframe.is_locked, keyframe.is_enabled});}
+    // Random access in the timeline: O(lights * log n) whatever the distance to the previous position
+    if (is_timeline_dirty) compile_commands();
+    light_manager.update(sample);
 
-    waveform_viewer.set_keyframes(waveform_keyframes);
+    if (is_scrub_audio_enabled) audio_manager.playGrain(sample);
 }
 
 void EliseApp::new_group(const std::string &name, const std::vector<size_t> &ids) {
@@ -847,7 +909,7 @@ void EliseApp::on_open_project() {
     open_project_dialog = std::make_unique<pfd::open_file>(
         "Open ELISE project",
         "",
-        std::vector<std::string>{"ELISE project", "*.elise"},
+        std::vector<std::string>{"ELISE project", "*.elise *.json"},
         pfd::opt::none
         );
     is_open_project_dialog_active = true;
@@ -863,6 +925,16 @@ void EliseApp::on_export() {
     is_export_project_dialog_active = true;
 }
 
+void EliseApp::on_export_json() {
+    export_json_dialog = std::make_unique<pfd::save_file>(
+        "Export project as JSON",
+        "",
+        std::vector<std::string>{"JSON file", "*.json"},
+        pfd::opt::none
+        );
+    is_export_json_dialog_active = true;
+}
+
 void EliseApp::on_load_song() {
     load_song_dialog = std::make_unique<pfd::open_file>(
         "Load MP3 file",
@@ -873,31 +945,65 @@ void EliseApp::on_load_song() {
     is_load_song_dialog_active = true;
 }
 
-void EliseApp::on_export_video() {
+void EliseApp::on_export_video(ExportPreset preset) {
+    export_settings = makeExportSettings(preset);
+
+    bool is_mkv = export_settings.codec == VideoCodec::ffv1;
     export_video_dialog = std::make_unique<pfd::save_file>(
         "Export project to video",
         "",
-        std::vector<std::string>{"MP4 file", "*.mp4"},
+        is_mkv ? std::vector<std::string>{"MKV file", "*.mkv"} : std::vector<std::string>{"MP4 file", "*.mp4"},
         pfd::opt::none);
     is_export_video_dialog_active = true;
 }
 
 
+ProjectSnapshot EliseApp::make_project_snapshot() {
+    // Keyframes are small flat structs, copying the command store only shares it
+    ProjectSnapshot snapshot;
+    snapshot.keyframes = keyframes.toVector();
+    snapshot.groups = groups;
+    snapshot.light_count = light_count;
+    snapshot.fixtures = fixtures;
+    snapshot.sample_rate = audio_manager.getSampleRate();
+    snapshot.max_uuid = max_keyframe_uuid;
+    snapshot.commands = keyframe_uuid_to_commands;
+    return snapshot;
+}
+
+ProjectData EliseApp::make_project_data() {
+    return make_project_snapshot().toProjectData();
+}
+
 void EliseApp::save_project(const std::string &path) {
+    project_saver.save(make_project_snapshot(), path);
+}
 
-    ProjectData project_data;
-    project_data.keyframes = keyframes;
-    project_data.groups = groups;
-    project_data.light_count = light_count;
-    project_data.sample_rate = audio_manager.getSampleRate();
-    project_data.keyframe_uuid_to_commands = keyframe_uuid_to_commands;
-    project_data.max_uuid = max_keyframe_uuid;
+void EliseApp::mark_project_modified() {
+    project_revision++;
+}
 
-    save(path, project_data);
-    is_loaded_from_file = true;
-    filepath = path;
+void EliseApp::update_project_saver() {
+    for (auto& result : project_saver.takeResults()) {
+        if (!result.is_success) {
+            std::cout << "Unable to save " << result.path << ": " << result.error << std::endl;
+            if (!result.is_autosave) ImGui::InsertNotification({ImGuiToastType::Error, 3000, "Unable to save the project !"});
+            continue;
+        }
 
-    ImGui::InsertNotification({ImGuiToastType::Info, 3000, "The project was saved !"});
+        if (!result.is_autosave) {
+            is_loaded_from_file = true;
+            filepath = result.path;
+            ImGui::InsertNotification({ImGuiToastType::Info, 3000, "The project was saved !"});
+        }
+    }
+
+    double now = glfwGetTime();
+    if (project_revision == autosaved_revision || now - last_autosave_time < autosave_interval) return;
+
+    project_saver.autosave(make_project_snapshot(), is_loaded_from_file ? filepath : "");
+    autosaved_revision = project_revision;
+    last_autosave_time = now;
 }
 
 void EliseApp::load_project(const std::string &path) {
@@ -905,23 +1011,31 @@ void EliseApp::load_project(const std::string &path) {
     bool error = false;
 
     try {
-        p = load(path);
+        p = loadProject(path);
     } catch (const std::exception &e) {
         ImGui::InsertNotification({ImGuiToastType::Error, 3000, "Not a valid ELISE file !"});
         error = true;
     }
 
     if (!error) {
-        keyframes = p.keyframes;
+        keyframes.assign(p.keyframes);
         groups = p.groups;
-        keyframe_uuid_to_commands = p.keyframe_uuid_to_commands;
+        keyframe_uuid_to_commands.assign(p.keyframe_uuid_to_commands);
+        edit_history.clear();
+        selected_keyframes.clear();
         light_count = p.light_count;
+        fixtures = p.fixtures;
         max_keyframe_uuid = p.max_uuid;
 
-        order_keyframes();
-        update_keyframes();
-        is_loaded_from_file = true;
-        filepath = path;
+        renderer.setFixtures(fixtures);
+        init_light_manager();
+
+        is_timeline_dirty = true;
+        autosaved_revision = project_revision;
+
+        // Saving writes the binary format: a JSON project goes through "Save as" instead of being overwritten
+        is_loaded_from_file = isBinaryProject(path);
+        filepath = is_loaded_from_file ? path : "";
 
         ImGui::InsertNotification({ImGuiToastType::Info, 3000, "The project was loaded !"});
     }
@@ -932,14 +1046,7 @@ void EliseApp::load_project(const std::string &path) {
 }
 
 void EliseApp::export_project(const std::string &path) {
-    order_keyframes();
-
-    ProjectData project_data;
-    project_data.keyframes = keyframes;
-    project_data.groups = groups;
-    project_data.light_count = light_count;
-    project_data.sample_rate = audio_manager.getSampleRate();
-    project_data.keyframe_uuid_to_commands = keyframe_uuid_to_commands;
+    auto project_data = make_project_data();
 
     auto content = generate_python_script(project_data);
 
@@ -947,13 +1054,19 @@ void EliseApp::export_project(const std::string &path) {
     if(n_path.size() >= 1) save_python_script(n_path, content);
 }
 
+void EliseApp::export_json(const std::string &path) {
+    saveJson(path, make_project_data());
+}
+
 void EliseApp::load_song(const std::string &path) {
     audio_manager.loadMP3(path);
-    auto& data = audio_manager.getOriginalSamples();
-    waveform_viewer.set_waveform_data(data);
+
+    // The store fills in as the song decodes, the waveform follows
+    auto store = audio_manager.getSampleStore();
     waveform_viewer.set_sample_rate(audio_manager.getSampleRate());
+    waveform_viewer.set_sample_store(store);
     sample_rate = audio_manager.getSampleRate();
-    sample_count = data.size();
+    sample_count = store->capacity();
 }
 
 void EliseApp::update_dialogs() {
@@ -995,10 +1108,20 @@ void EliseApp::update_dialogs() {
         is_export_project_dialog_active = false;
     } else if (not export_project_dialog) is_export_project_dialog_active = false;
 
+    if (export_json_dialog && export_json_dialog->ready()) {
+        auto filename = export_json_dialog->result();
+        if(filename.length() > 0){
+            filename = ensure_extension(filename, ".json");
+            export_json(filename);
+        }
+        export_json_dialog.reset();
+        is_export_json_dialog_active = false;
+    } else if (not export_json_dialog) is_export_json_dialog_active = false;
+
     if (export_video_dialog && export_video_dialog->ready()) {
         auto filename = export_video_dialog->result();
         if(filename.length() > 0) {
-            filename = ensure_extension(filename, ".mp4");
+            filename = ensure_extension(filename, getExportExtension(export_settings));
             start_export(filename);
         }
         export_video_dialog.reset();
@@ -1009,6 +1132,7 @@ void EliseApp::update_dialogs() {
                         || is_load_song_dialog_active
                         || is_save_project_dialog_active
                         || is_export_project_dialog_active
+                        || is_export_json_dialog_active
                         || is_export_video_dialog_active;
 }
 
@@ -1081,53 +1205,44 @@ void EliseApp::color_picker(const char *label, Color &color) {
 void EliseApp::start_export(const std::string &path) {
     stop_audio();
 
-    is_exporting = true;
-
-    order_keyframes();
-
-    auto last_k = keyframes.back();
+    auto last_k = keyframes.empty() ? Keyframe{0} : keyframes.back();
 
     compile_commands();
 
-    encoder = new MP4Encoder(path, 750, 370, export_framerate, sample_rate);
-    encoder->addAudio(audio_manager.getOriginalSamples());
-    current_frame = 0;
+    // The soundtrack has to be complete before the encoder sees it
+    audio_manager.waitUntilLoaded();
 
-    max_frame = (last_k.trigger_sample * export_framerate / sample_rate);
-}
-
-void EliseApp::export_frame() {
-    if (!is_exporting) return;
-
-    int current_sample = current_frame * sample_rate / export_framerate;
-
-    renderer.setViewport(750, 370);
-    light_manager.updateAnimations(current_sample);
-    light_manager.updateLightStates(current_sample);
-
-    auto lights = light_manager.getLightStates();
-
-    auto vec_light = std::array<glm::vec4, 12>{};
-    int i = 0;
-    for (auto light: lights) {
-        vec_light.at(i) = {light.r / 255.f, light.g / 255.f, light.b / 255.f, light.a / 255.f};
-        i++;
+    try {
+        exporter = std::make_unique<VideoExporter>(path, light_manager, renderer,
+                                                   audio_manager.getOriginalSamples(), sample_rate,
+                                                   export_settings, last_k.trigger_sample);
+    } catch (const std::exception& e) {
+        ImGui::InsertNotification({ImGuiToastType::Error, 5000, "Unable to start the export !"});
+        return;
     }
 
-    renderer.Render(vec_light);
-    encoder->addOpenGLFrame(renderer.GetFboOut());
+    is_exporting = true;
 }
 
 void EliseApp::update_export() {
     if (!is_exporting) return;
-    if (current_frame < max_frame) {
-        export_frame();
-        current_frame++;
+
+    // Export for most of a UI frame instead of a fixed number of frames per vsync
+    double budget = export_frame_budget / target_application_framerate;
+
+    bool is_done = false;
+    try {
+        is_done = exporter->exportFor(budget);
+    } catch (const std::exception& e) {
+        exporter.reset();
+        is_exporting = false;
+        ImGui::InsertNotification({ImGuiToastType::Error, 5000, "The export failed !"});
+        return;
     }
-    else {
+
+    if (is_done) {
+        exporter.reset();
         is_exporting = false;
-        encoder->finalize();
-        delete encoder;
 
         ImGui::InsertNotification({ImGuiToastType::Success, 5000, "Video exported !"});
     }
@@ -11,14 +11,19 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include "CommandStore.h"
+#include "EditHistory.h"
+#include "KeyframeStore.h"
 #include "WaveformViewer.h"
 #include "AudioManager.h"
 #include <GLFW/glfw3.h>
 
-#include "Encoder.h"
+#include "VideoExporter.h"
 #include "LightManager.h"
 #include "ImGui_themes.h"
 #include "JsonHandler.h"
+#include "ProjectFile.h"
+#include "ProjectSaver.h"
 #include "Exporter.h"
 #include "../libs/portable_file_dialog.h"
 #include "file_utils.h"
@@ -63,14 +68,14 @@ private:
     void update();
     void update_waveform_viewer();
     void update_light_manager();
+    AudioClock::clock::time_point get_frame_display_time() const;
 
     // Audio player
     void play_audio();
     void stop_audio();
 
-    // Keyframes handling
-    void order_keyframes();
-    void build_keyframe_uuid_to_index_map();
+    // Timeline invalidation
+    void invalidate_range(int64_t from, int64_t to, const std::vector<int>& groups);
 
 
     // Callback
@@ -81,8 +86,12 @@ private:
     void keyframe_selection_callback(int64_t keyframe_uuid);
     void reset_selection_callback();
     void keyframe_unselection_callback(int64_t keyframe_uuid);
+    void cursor_scrub_callback(int64_t sample);
 
-    void update_keyframes();
+    // Undo / redo
+    void undo_edit();
+    void redo_edit();
+    void prune_selection();
 
     void new_group(const std::string& name, const std::vector<size_t>& ids);
 
@@ -90,12 +99,18 @@ private:
     void on_save_as();
     void on_open_project();
     void on_export();
+    void on_export_json();
     void on_load_song();
-    void on_export_video();
+    void on_export_video(ExportPreset preset);
 
+    ProjectSnapshot make_project_snapshot();
+    ProjectData make_project_data();
     void save_project(const std::string& path);
+    void mark_project_modified();
+    void update_project_saver();
     void load_project(const std::string& path);
     void export_project(const std::string& path);
+    void export_json(const std::string& path);
     void load_song(const std::string& path);
 
     void update_dialogs();
@@ -108,7 +123,6 @@ private:
     void color_picker(const char* label, Color& color);
 
     void start_export(const std::string& path);
-    void export_frame();
     void update_export();
 
 
@@ -123,25 +137,32 @@ private:
     Odin::Renderer renderer;
 
     int light_count = 12;
+    std::vector<Fixture> fixtures = defaultFixtureLayout();
     std::vector<Group> groups;
 
     // Player state
     float playback_speed = 1.0f;
+    bool is_scrub_audio_enabled = false;
     int sample_rate = 41000;
     int sample_count = 0;
 
     // Keyframes
-    std::vector<Keyframe> keyframes;
-    std::map<int64_t, int> keyframe_uuid_to_index;
+    KeyframeStore keyframes;
     std::set<int64_t> selected_keyframes;
     int64_t max_keyframe_uuid = 0;
     bool is_keyframe_edition_window_visible = true;
 
     // Commands
-    std::unordered_map<int64_t, std::vector<Command>> keyframe_uuid_to_commands;
+    CommandStore keyframe_uuid_to_commands;
     int selected_command = 0;
     bool is_command_edition_window_visible = false;
 
+    // Every keyframe and command edit goes through the history
+    EditHistory edit_history{keyframes, keyframe_uuid_to_commands};
+
+    // Set when the whole show must be recompiled, otherwise edits patch the timeline in place
+    bool is_timeline_dirty = true;
+
     // Project manager state
     std::string project_path;
     bool is_project_manager_visible = false;
@@ -162,6 +183,9 @@ private:
     std::unique_ptr<pfd::save_file> export_project_dialog;
     bool is_export_project_dialog_active = false;
 
+    std::unique_ptr<pfd::save_file> export_json_dialog;
+    bool is_export_json_dialog_active = false;
+
     std::unique_ptr<pfd::save_file> export_video_dialog;
     bool is_export_video_dialog_active = false;
 
@@ -169,6 +193,13 @@ private:
     bool is_loaded_from_file = false;
     std::string filepath;
 
+    // Saves and autosaves are written in the background from snapshots
+    ProjectSaver project_saver;
+    double autosave_interval = 60.0; // Seconds
+    double last_autosave_time = 0.0;
+    uint64_t project_revision = 0;
+    uint64_t autosaved_revision = 0;
+
     // Copy / Paste system
     //--------------------
     Command copied_command;
@@ -183,10 +214,10 @@ private:
     // Video exporting system
     //-----------------------
     bool is_exporting = false;
-    double export_framerate = 60.f;
-    int current_frame = 0;
-    int max_frame = 0;
-    MP4Encoder *encoder = nullptr;
+    ExportSettings export_settings = makeExportSettings(ExportPreset::master);
+    // Share of a UI frame spent exporting, the rest keeps the UI responsive
+    double export_frame_budget = 0.75;
+    std::unique_ptr<VideoExporter> exporter;
 };
 
 
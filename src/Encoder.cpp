@@ -2,35 +2,70 @@
 // MP4Encoder.cpp
 #include "Encoder.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "ThreadPool.h"
+
 
 
 MP4Encoder::MP4Encoder(const std::string& filename,
-                       int width, int height, int fps,
+                       const ExportSettings& settings,
                        int sample_rate, int channels)
     : _filename(filename)
-    , _width(width)
-    , _height(height)
-    , _fps(fps)
+    , _settings(settings)
+    , _width(settings.width)
+    , _height(settings.height)
+    , _frameRate(av_d2q(settings.framerate, 100000))
     , _sampleRate(sample_rate)
     , _channels(channels)
 {
+    validateExportSettings(settings);
+
     avformat_network_init();
     initOutput();
     initVideoStream();
-    initAudioStream();
+    if (_channels > 0) initAudioStream();
     writeHeader();
 
-    // Allocate packet
+    // Allocate packets
     _pkt = av_packet_alloc();
+    _videoPkt = av_packet_alloc();
 
-    // Prepare RGB buffer for glReadPixels
-    _rgbBuffer.resize(_width * _height * 4);
+    initReadbackBuffers();
+    initPipeline();
+}
+
+MP4Encoder::MP4Encoder(const std::string& filename,
+                       const std::string& video_source,
+                       const ExportSettings& settings,
+                       int sample_rate, int channels)
+    : _filename(filename)
+    , _settings(settings)
+    , _width(settings.width)
+    , _height(settings.height)
+    , _frameRate(av_d2q(settings.framerate, 100000))
+    , _sampleRate(sample_rate)
+    , _channels(channels)
+{
+    avformat_network_init();
+    initOutput();
+    initCopiedVideoStream(video_source);
+    if (_channels > 0) initAudioStream();
+    writeHeader();
+
+    _pkt = av_packet_alloc();
 }
 
 MP4Encoder::~MP4Encoder() {
     // ensure finalize was called
     if (_fmtCtx) {
-        finalize();
+        try {
+            finalize();
+        } catch (const std::exception& e) {
+            std::cout << "Failed to finalize " << _filename << ": " << e.what() << std::endl;
+        }
     }
 }
 
@@ -44,17 +79,36 @@ void MP4Encoder::initOutput() {
 }
 
 void MP4Encoder::initVideoStream() {
-    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-    if (!codec) throw std::runtime_error("H264 encoder not found");
+    const bool isLossless = _settings.codec == VideoCodec::ffv1;
+    const AVCodecID codecId = isLossless ? AV_CODEC_ID_FFV1 : AV_CODEC_ID_H264;
+    // FFV1 keeps the full chroma resolution, the intermediate must not lose anything
+    _pixFmt = isLossless ? AV_PIX_FMT_YUV444P : AV_PIX_FMT_YUV420P;
+
+    const AVCodec* codec = avcodec_find_encoder(codecId);
+    if (!codec) throw std::runtime_error(std::string(avcodec_get_name(codecId)) + " encoder not found");
     _videoStream = avformat_new_stream(_fmtCtx, codec);
     _videoCtx = avcodec_alloc_context3(codec);
-    _videoCtx->codec_id = AV_CODEC_ID_H264;
+    _videoCtx->codec_id = codecId;
     _videoCtx->width = _width;
     _videoCtx->height = _height;
-    _videoCtx->pix_fmt = AV_PIX_FMT_YUV420P;
-    _videoCtx->time_base = AVRational{1, _fps};
-    _videoCtx->bit_rate = 800000;
-    _videoCtx->gop_size = 12;
+    _videoCtx->pix_fmt = _pixFmt;
+    _videoCtx->time_base = av_inv_q(_frameRate);
+    _videoCtx->framerate = _frameRate;
+    _videoCtx->gop_size = _settings.gop_size;
+    if (_settings.max_b_frames >= 0) _videoCtx->max_b_frames = _settings.max_b_frames;
+    // Let libavcodec spread the encode over its own threads
+    _videoCtx->thread_count = _settings.thread_count;
+    _videoCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+    if (isLossless) {
+        _videoCtx->level = 3;   // Sliced FFV1, encodes in parallel
+    } else {
+        if (_settings.crf >= 0) setCodecOption("crf", std::to_string(_settings.crf));
+        else _videoCtx->bit_rate = _settings.bitrate;
+        if (!_settings.preset.empty()) setCodecOption("preset", _settings.preset);
+        if (!_settings.tune.empty()) setCodecOption("tune", _settings.tune);
+    }
+
     if (_fmtCtx->oformat->flags & AVFMT_GLOBALHEADER)
         _videoCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     int ret = avcodec_open2(_videoCtx, codec, NULL);
@@ -62,20 +116,84 @@ void MP4Encoder::initVideoStream() {
     avcodec_parameters_from_context(_videoStream->codecpar, _videoCtx);
     _videoStream->time_base = _videoCtx->time_base;
 
-    // Allocate video frame
-    _videoFrame = av_frame_alloc();
-    _videoFrame->format = _videoCtx->pix_fmt;
-    _videoFrame->width = _width;
-    _videoFrame->height = _height;
-    ret = av_frame_get_buffer(_videoFrame, 0);
+    // Allocate the pool of video frames
+    for (int i = 0; i < PIPELINE_DEPTH; ++i) {
+        AVFrame* frame = av_frame_alloc();
+        frame->format = _videoCtx->pix_fmt;
+        frame->width = _width;
+        frame->height = _height;
+        ret = av_frame_get_buffer(frame, 0);
+        CHECK_ERR(ret);
+        _yuvFrames.push_back(frame);
+    }
+
+    // Initialize sws for RGBA->YUV, one context per band so the bands convert in parallel.
+    // Bands start on a chroma row boundary to keep the chroma rows whole
+    const int chromaRowMask = (1 << av_pix_fmt_desc_get(_pixFmt)->log2_chroma_h) - 1;
+    const int swsFlags = _settings.fast_conversion ? SWS_FAST_BILINEAR : SWS_BILINEAR | SWS_ACCURATE_RND;
+
+    int sliceCount = std::clamp(_height / 64, 1, int(ThreadPool::global().size()) + 1);
+    for (int i = 0; i <= sliceCount; ++i) {
+        _sliceRows.push_back(i == sliceCount ? _height : (_height * i / sliceCount) & ~chromaRowMask);
+    }
+    for (int i = 0; i < sliceCount; ++i) {
+        int rows = _sliceRows[i + 1] - _sliceRows[i];
+        SwsContext* sws = sws_getContext(
+            _width, rows, AV_PIX_FMT_RGBA,
+            _width, rows, _pixFmt,
+            swsFlags, NULL, NULL, NULL);
+        if (!sws) throw std::runtime_error("Failed to init sws context");
+        _swsSlices.push_back(sws);
+    }
+}
+
+namespace {
+    // Packets of two streams can only be mixed if they decode with the same parameters
+    bool haveSameVideoParameters(const AVCodecParameters* a, const AVCodecParameters* b) {
+        return a->codec_id == b->codec_id
+            && a->width == b->width
+            && a->height == b->height
+            && a->format == b->format
+            && a->extradata_size == b->extradata_size
+            && (a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0);
+    }
+
+    AVStream* openVideoInput(const std::string& path, AVFormatContext*& input) {
+        int ret = avformat_open_input(&input, path.c_str(), nullptr, nullptr);
+        CHECK_ERR(ret);
+
+        ret = avformat_find_stream_info(input, nullptr);
+        if (ret >= 0) ret = av_find_best_stream(input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (ret < 0) {
+            avformat_close_input(&input);
+            CHECK_ERR(ret);
+        }
+        return input->streams[ret];
+    }
+}
+
+void MP4Encoder::initCopiedVideoStream(const std::string& video_source) {
+    AVFormatContext* input = nullptr;
+    AVStream* inStream = openVideoInput(video_source, input);
+
+    _copiedParams = avcodec_parameters_alloc();
+    int ret = _copiedParams ? avcodec_parameters_copy(_copiedParams, inStream->codecpar) : AVERROR(ENOMEM);
+    avformat_close_input(&input);
+    CHECK_ERR(ret);
+
+    _videoStream = avformat_new_stream(_fmtCtx, nullptr);
+    if (!_videoStream) throw std::runtime_error("Failed to create the video stream");
+    ret = avcodec_parameters_copy(_videoStream->codecpar, _copiedParams);
     CHECK_ERR(ret);
+    // The tag of the source container may not exist in the output one
+    _videoStream->codecpar->codec_tag = 0;
+    _videoStream->time_base = av_inv_q(_frameRate);
+}
 
-    // Initialize sws for RGBA->YUV420P
-    _swsCtx = sws_getContext(
-        _width, _height, AV_PIX_FMT_RGBA,
-        _width, _height, AV_PIX_FMT_YUV420P,
-        SWS_BILINEAR, NULL, NULL, NULL);
-    if (!_swsCtx) throw std::runtime_error("Failed to init sws context");
+void MP4Encoder::setCodecOption(const char* name, const std::string& value) {
+    // Only libx264 knows these, other H264 encoders keep their defaults
+    if (av_opt_set(_videoCtx->priv_data, name, value.c_str(), 0) < 0)
+        std::cout << "The video encoder ignored the option " << name << "=" << value << std::endl;
 }
 
 void MP4Encoder::initAudioStream() {
@@ -89,7 +207,7 @@ void MP4Encoder::initAudioStream() {
     av_channel_layout_default(&_audioCtx->ch_layout, 1);
 
     _audioCtx->sample_fmt = codec->sample_fmts[0]; // e.g. AV_SAMPLE_FMT_FLTP
-    _audioCtx->bit_rate = 128000*2;
+    _audioCtx->bit_rate = _settings.audio_bitrate;
     _audioCtx->time_base = AVRational{1, _sampleRate};
     if (_fmtCtx->oformat->flags & AVFMT_GLOBALHEADER)
         _audioCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -126,85 +244,281 @@ void MP4Encoder::writeHeader() {
     CHECK_ERR(ret);
 }
 
-void MP4Encoder::addAudio(const std::vector<float>& samples) {
-    size_t cursor = 0;
-    size_t frameSize = _audioCtx->frame_size;
-    while (cursor + frameSize <= samples.size()) {
-        // copy raw data
-        if (_swrCtx) {
-            // convert interleaved float to planar float
-            const uint8_t* inData[1] = {(const uint8_t*)(samples.data() + cursor)};
-            int ret = swr_convert(_swrCtx,
-                _audioFrame->data, frameSize,
-                inData, frameSize);
-            CHECK_ERR(ret);
-        } else {
-            // direct copy
-            memcpy(_audioFrame->data[0], samples.data() + cursor, frameSize * sizeof(float) * _channels);
-        }
-        _audioFrame->pts = _audioPts;
-        _audioPts += frameSize;
+void MP4Encoder::setAudio(std::span<const float> samples) {
+    _audioSamples = samples.data();
+    _audioSampleCount = samples.size();
+}
+
+void MP4Encoder::encodeAudioUntil(size_t sample) {
+    if (!_audioCtx) return;
+    sample = std::min(sample, _audioSampleCount);
+    const size_t frameSize = _audioCtx->frame_size;
+
+    while (size_t(_audioPts) + frameSize <= sample) {
+        encodeAudioFrame(_audioSamples + _audioPts, frameSize);
+    }
+
+    // The last frame of the song may be shorter than the codec frame
+    if (sample == _audioSampleCount && size_t(_audioPts) < sample) {
+        encodeAudioFrame(_audioSamples + _audioPts, sample - _audioPts);
+    }
+}
+
+void MP4Encoder::encodeAudioFrame(const float* samples, int count) {
+    // The codec may still hold a reference on the previous frame
+    int ret = av_frame_make_writable(_audioFrame);
+    CHECK_ERR(ret);
 
-        // encode
-        int ret = avcodec_send_frame(_audioCtx, _audioFrame);
+    // copy raw data
+    if (_swrCtx) {
+        // convert interleaved float to planar float
+        const uint8_t* inData[1] = {(const uint8_t*)samples};
+        ret = swr_convert(_swrCtx,
+            _audioFrame->data, count,
+            inData, count);
         CHECK_ERR(ret);
-        while (avcodec_receive_packet(_audioCtx, _pkt) == 0) {
-            _pkt->stream_index = _audioStream->index;
-            av_packet_rescale_ts(_pkt, _audioCtx->time_base, _audioStream->time_base);
-            ret = av_interleaved_write_frame(_fmtCtx, _pkt);
-            CHECK_ERR(ret);
-            av_packet_unref(_pkt);
-        }
-        cursor += frameSize;
+    } else {
+        // direct copy
+        memcpy(_audioFrame->data[0], samples, count * sizeof(float) * _channels);
+    }
+
+    // Only the last frame may be short, libavcodec accepts it as is and pads it
+    _audioFrame->nb_samples = count;
+    _audioFrame->pts = _audioPts;
+    _audioPts += count;
+
+    // encode
+    ret = avcodec_send_frame(_audioCtx, _audioFrame);
+    CHECK_ERR(ret);
+    writePackets(_audioCtx, _audioStream, _pkt);
+}
+
+void MP4Encoder::initReadbackBuffers() {
+    glGenBuffers(READBACK_BUFFER_COUNT, _readbackBuffers);
+    for (GLuint buffer : _readbackBuffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(_width) * _height * 4, nullptr, GL_STREAM_READ);
     }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void MP4Encoder::initPipeline() {
+    _rgbaFrames.resize(PIPELINE_DEPTH);
+    for (int i = 0; i < PIPELINE_DEPTH; ++i) {
+        _rgbaFrames[i].resize(size_t(_width) * _height * 4);
+        _freeRGBAFrames.push(i);
+        _freeYUVFrames.push(i);
+    }
+
+    _convertThread = std::thread([this]() { convertLoop(); });
+    _encodeThread = std::thread([this]() { encodeLoop(); });
+}
+
+void MP4Encoder::stopPipeline() {
+    // Closing a queue lets its consumer drain it and exit
+    _rgbaQueue.close();
+    if (_convertThread.joinable()) _convertThread.join();
+    _yuvQueue.close();
+    if (_encodeThread.joinable()) _encodeThread.join();
 }
 
 void MP4Encoder::addOpenGLFrame(const Odin::FrameBuffer& fbo) {
-    // bind FBO and read pixels
+    rethrowPipelineError();
+
+    // The ring is full: the oldest frame has had READBACK_BUFFER_COUNT - 1 frames to reach the CPU
+    if (_pendingReadbacks == READBACK_BUFFER_COUNT) readOldestBack();
+
+    // Start the transfer into the next buffer, glReadPixels returns immediately with a PBO bound
     fbo.Use();
-    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, _rgbBuffer.data());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _readbackBuffers[_nextReadback]);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    int rowSize = _width * 4;  // bytes per scanline
-    std::vector<uint8_t> tmp(rowSize);
-    for (int y = 0; y < _height / 2; ++y) {
-        uint8_t* top    = _rgbBuffer.data() + y * rowSize;
-        uint8_t* bottom = _rgbBuffer.data() + (_height - 1 - y) * rowSize;
-        // swap
-        memcpy(tmp.data(),       top,    rowSize);
-        memcpy(top,              bottom, rowSize);
-        memcpy(bottom,           tmp.data(), rowSize);
+    _nextReadback = (_nextReadback + 1) % READBACK_BUFFER_COUNT;
+    _pendingReadbacks++;
+}
+
+void MP4Encoder::readOldestBack() {
+    int oldest = (_nextReadback - _pendingReadbacks + READBACK_BUFFER_COUNT) % READBACK_BUFFER_COUNT;
+    _pendingReadbacks--;
+
+    // Blocks while the conversion stage is PIPELINE_DEPTH frames behind
+    auto slot = _freeRGBAFrames.pop();
+    if (!slot) {
+        rethrowPipelineError();
+        return;
     }
 
-    // prepare source data pointers
-    uint8_t* srcSlices[1] = {_rgbBuffer.data()};
-    int srcStride[1] = {4 * _width};
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _readbackBuffers[oldest]);
+    auto pixels = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(_width) * _height * 4, GL_MAP_READ_BIT);
+    if (pixels) {
+        // The mapping is only valid on this thread, hand a copy to the next stage
+        memcpy(_rgbaFrames[*slot].data(), pixels, _rgbaFrames[*slot].size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        _rgbaQueue.push({*slot, _videoPts++});
+    } else {
+        std::cout << "Failed to map readback buffer, frame dropped" << std::endl;
+        _freeRGBAFrames.push(*slot);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
 
-    // convert to YUV420P
-    sws_scale(_swsCtx,
-        srcSlices, srcStride, 0, _height,
-        _videoFrame->data, _videoFrame->linesize);
+void MP4Encoder::convertLoop() {
+    try {
+        while (auto rgba = _rgbaQueue.pop()) {
+            auto yuvSlot = _freeYUVFrames.pop();
+            if (!yuvSlot) break;
 
-    // encode
-    _videoFrame->pts = _videoPts++;
-    int ret = avcodec_send_frame(_videoCtx, _videoFrame);
-    CHECK_ERR(ret);
-    while (avcodec_receive_packet(_videoCtx, _pkt) == 0) {
-        _pkt->stream_index = _videoStream->index;
-        av_packet_rescale_ts(_pkt, _videoCtx->time_base, _videoStream->time_base);
-        ret = av_interleaved_write_frame(_fmtCtx, _pkt);
+            AVFrame* frame = _yuvFrames[*yuvSlot];
+            // The codec may still hold a reference on this frame's buffers
+            int ret = av_frame_make_writable(frame);
+            CHECK_ERR(ret);
+
+            convertRGBAFrame(_rgbaFrames[rgba->slot].data(), frame);
+
+            _freeRGBAFrames.push(rgba->slot);
+            _yuvQueue.push({*yuvSlot, rgba->pts});
+        }
+    } catch (...) {
+        setPipelineError(std::current_exception());
+    }
+}
+
+void MP4Encoder::convertRGBAFrame(const uint8_t* pixels, AVFrame* frame) {
+    const int rowSize = 4 * _width;
+
+    ThreadPool::global().parallel_for(_swsSlices.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const int firstRow = _sliceRows[i];
+
+            // OpenGL rows go bottom to top: start on the last row with a negative stride to flip for free
+            const uint8_t* srcSlices[1] = {pixels + size_t(_height - 1 - firstRow) * rowSize};
+            int srcStride[1] = {-rowSize};
+
+            const int chromaRow = firstRow >> av_pix_fmt_desc_get(_pixFmt)->log2_chroma_h;
+            uint8_t* dstSlices[3] = {
+                frame->data[0] + size_t(firstRow) * frame->linesize[0],
+                frame->data[1] + size_t(chromaRow) * frame->linesize[1],
+                frame->data[2] + size_t(chromaRow) * frame->linesize[2]
+            };
+
+            // convert to YUV
+            sws_scale(_swsSlices[i],
+                srcSlices, srcStride, 0, _sliceRows[i + 1] - firstRow,
+                dstSlices, frame->linesize);
+        }
+    });
+}
+
+void MP4Encoder::encodeLoop() {
+    try {
+        while (auto yuv = _yuvQueue.pop()) {
+            AVFrame* frame = _yuvFrames[yuv->slot];
+            frame->pts = yuv->pts;
+
+            // encode
+            int ret = avcodec_send_frame(_videoCtx, frame);
+            CHECK_ERR(ret);
+            writePackets(_videoCtx, _videoStream, _videoPkt);
+
+            _freeYUVFrames.push(yuv->slot);
+
+            // Keep the audio level with the video so the muxer interleaves without piling packets up
+            encodeAudioUntil(av_rescale_q(yuv->pts + 1, _videoCtx->time_base, AVRational{1, _sampleRate}));
+        }
+    } catch (...) {
+        setPipelineError(std::current_exception());
+    }
+}
+
+void MP4Encoder::setPipelineError(std::exception_ptr error) {
+    {
+        std::lock_guard lock(_errorMutex);
+        if (!_pipelineError) _pipelineError = error;
+    }
+
+    // Unblock every stage, the export is lost anyway
+    _freeRGBAFrames.close();
+    _rgbaQueue.close();
+    _freeYUVFrames.close();
+    _yuvQueue.close();
+}
+
+void MP4Encoder::rethrowPipelineError() {
+    std::lock_guard lock(_errorMutex);
+    if (_pipelineError) std::rethrow_exception(_pipelineError);
+}
+
+void MP4Encoder::writePackets(AVCodecContext* ctx, AVStream* stream, AVPacket* pkt) {
+    while (avcodec_receive_packet(ctx, pkt) == 0) {
+        pkt->stream_index = stream->index;
+        av_packet_rescale_ts(pkt, ctx->time_base, stream->time_base);
+
+        std::lock_guard lock(_muxMutex);
+        int ret = av_interleaved_write_frame(_fmtCtx, pkt);
+        av_packet_unref(pkt);
         CHECK_ERR(ret);
-        av_packet_unref(_pkt);
     }
 }
 
 void MP4Encoder::flushEncoder(AVCodecContext* ctx, AVStream* stream) {
     avcodec_send_frame(ctx, nullptr);
-    while (avcodec_receive_packet(ctx, _pkt) == 0) {
-        _pkt->stream_index = stream->index;
-        av_interleaved_write_frame(_fmtCtx, _pkt);
-        av_packet_unref(_pkt);
+    writePackets(ctx, stream, _pkt);
+}
+
+void MP4Encoder::appendVideoFile(const std::string& path) {
+    rethrowPipelineError();
+
+    AVFormatContext* input = nullptr;
+    AVStream* inStream = openVideoInput(path, input);
+    const int videoIndex = inStream->index;
+
+    if (_copiedParams && !haveSameVideoParameters(_copiedParams, inStream->codecpar)) {
+        avformat_close_input(&input);
+        throw std::runtime_error("Can't stream-copy " + path + ": its codec parameters differ from the other segments");
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    auto cleanup = [&]() {
+        av_packet_free(&pkt);
+        avformat_close_input(&input);
+    };
+
+    // Both modes count the video in frames
+    const AVRational frameTimeBase = av_inv_q(_frameRate);
+    const int64_t offset = av_rescale_q(_videoPts, frameTimeBase, _videoStream->time_base);
+    int ret = 0;
+    int64_t frames = 0;
+
+    while (av_read_frame(input, pkt) >= 0) {
+        if (pkt->stream_index != videoIndex) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        av_packet_rescale_ts(pkt, inStream->time_base, _videoStream->time_base);
+        if (pkt->pts != AV_NOPTS_VALUE) pkt->pts += offset;
+        if (pkt->dts != AV_NOPTS_VALUE) pkt->dts += offset;
+        pkt->stream_index = _videoStream->index;
+        pkt->pos = -1;
+        frames++;
+
+        {
+            std::lock_guard lock(_muxMutex);
+            ret = av_interleaved_write_frame(_fmtCtx, pkt);
+        }
+        av_packet_unref(pkt);
+        if (ret < 0) {
+            cleanup();
+            CHECK_ERR(ret);
+        }
+
+        encodeAudioUntil(av_rescale_q(_videoPts + frames, frameTimeBase, AVRational{1, _sampleRate}));
     }
+
+    _videoPts += frames;
+    cleanup();
 }
 
 void MP4Encoder::writeTrailer() {
@@ -212,22 +526,51 @@ void MP4Encoder::writeTrailer() {
 }
 
 void MP4Encoder::finalize() {
-    // flush audio & video
-    flushEncoder(_audioCtx, _audioStream);
-    flushEncoder(_videoCtx, _videoStream);
+    // Encode the frames still in flight
+    try {
+        while (_pendingReadbacks > 0) readOldestBack();
+    } catch (...) {
+        setPipelineError(std::current_exception());
+    }
+    // Stream-copy mode never created the GL buffers
+    if (_videoCtx) glDeleteBuffers(READBACK_BUFFER_COUNT, _readbackBuffers);
+    stopPipeline();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(_errorMutex);
+        error = _pipelineError;
+    }
 
-    writeTrailer();
+    // flush video, then audio
+    if (!error) {
+        // End the video stream first, so the muxer can write the audio tail as it comes instead of
+        // buffering it against a video stream that may still produce packets
+        if (_videoCtx) flushEncoder(_videoCtx, _videoStream);
+
+        // The song usually goes on after the last keyframe
+        encodeAudioUntil(_audioSampleCount);
+        if (_audioCtx) flushEncoder(_audioCtx, _audioStream);
+
+        writeTrailer();
+    }
 
     // cleanup
     avcodec_free_context(&_videoCtx);
+    avcodec_parameters_free(&_copiedParams);
     avcodec_free_context(&_audioCtx);
-    sws_freeContext(_swsCtx);
+    for (auto sws : _swsSlices) sws_freeContext(sws);
+    _swsSlices.clear();
     if (_swrCtx) swr_free(&_swrCtx);
-    av_frame_free(&_videoFrame);
+    for (auto& frame : _yuvFrames) av_frame_free(&frame);
+    _yuvFrames.clear();
     av_frame_free(&_audioFrame);
     av_packet_free(&_pkt);
+    av_packet_free(&_videoPkt);
     if (!(_fmtCtx->oformat->flags & AVFMT_NOFILE))
         avio_close(_fmtCtx->pb);
     avformat_free_context(_fmtCtx);
     _fmtCtx = nullptr;
+
+    if (error) std::rethrow_exception(error);
 }
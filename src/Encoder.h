@@ -1,12 +1,18 @@
 #ifndef MP4ENCODER_H
 #define MP4ENCODER_H
 
+#include <exception>
+#include <mutex>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 #include <stdexcept>
 
 #include "../libs/glad/include/glad/glad.h"         // for GLuint7
 #include "2D renderer/Framebuffer.h"
+#include "BoundedQueue.h"
+#include "ExportSettings.h"
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
@@ -14,37 +20,63 @@ extern "C" {
 #include <libavutil/channel_layout.h>
 #include <libavutil/samplefmt.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
 }
 
+// The export runs as a pipeline: the GL thread renders and reads back, a conversion thread turns RGBA into
+// YUV in parallel slices, and an encoding thread feeds libavcodec (itself frame/slice threaded).
+// Stages are linked by bounded queues, so the export goes as fast as its slowest stage.
 class MP4Encoder {
 public:
     /**
-     * @param filename   Output MP4 file path
-     * @param width      Video width (even number)
-     * @param height     Video height (even number)
-     * @param fps        Frames per second
+     * @param filename   Output file path, the container is picked from the extension (.mp4, .mkv)
+     * @param settings   Resolution, framerate and codec settings, see ExportSettings
      * @param sample_rate Audio sample rate (Hz)
-     * @param channels   Number of audio channels (1=mono,2=stereo)
+     * @param channels   Number of audio channels (0=no audio track,1=mono,2=stereo)
      */
     MP4Encoder(const std::string& filename,
-               int width, int height, int fps,
+               const ExportSettings& settings,
+               int sample_rate, int channels = 1);
+
+    /**
+     * Stream-copy mode: the video stream takes its codec parameters (extradata included) from the first file
+     * passed to appendVideoFile, no video encoder, readback buffers nor pipeline threads are created.
+     * Only appendVideoFile can add video, the soundtrack is encoded as usual.
+     *
+     * @param video_source A file the video is copied from, usually the first export segment
+     */
+    MP4Encoder(const std::string& filename,
+               const std::string& video_source,
+               const ExportSettings& settings,
                int sample_rate, int channels = 1);
     ~MP4Encoder();
 
     /**
-     * Feed audio samples into encoder. samples.size() can be arbitrary; internal buffering handles frame-size slicing.
+     * Set the soundtrack. It is encoded in step with the video, so the muxer only ever buffers a few packets.
+     * The samples are not copied and must outlive the encoder. Call it before the first frame.
+     * Audio past the last video frame is encoded by finalize(), the last partial frame is kept.
      */
-    void addAudio(const std::vector<float>& samples);
+    void setAudio(std::span<const float> samples);
 
     /**
-     * Capture and encode one OpenGL frame from given FBO.
+     * Capture and encode one OpenGL frame from given FBO. Must be called from the thread owning the GL context.
+     * The readback is asynchronous: the frame is encoded a few calls later, once the GPU is done with it.
+     * Errors from the conversion and encoding threads are rethrown here.
      *
      * @param fbo     Framebuffer object ID
      */
     void addOpenGLFrame(const Odin::FrameBuffer& fbo);
 
+    /**
+     * Stream-copy the video of a file encoded with the same settings (e.g. an export segment) after the frames
+     * already written. The soundtrack follows along. Its first frame must be a keyframe and it must have no
+     * B-frames, so the timestamps stay monotonic across files. Don't mix with addOpenGLFrame.
+     * In stream-copy mode, throws if the file's codec parameters differ from the video source.
+     */
+    void appendVideoFile(const std::string& path);
+
     /**
      * Finalize encoding, flush encoders, and close file.
      */
@@ -53,37 +85,90 @@ public:
 private:
     void initOutput();
     void initVideoStream();
+    void initCopiedVideoStream(const std::string& video_source);
+    void setCodecOption(const char* name, const std::string& value);
     void initAudioStream();
     void writeHeader();
     void writeTrailer();
     void flushEncoder(AVCodecContext* ctx, AVStream* stream);
+    // Encode the soundtrack up to `sample`, rounded down to whole codec frames unless it reaches the end
+    void encodeAudioUntil(size_t sample);
+    void encodeAudioFrame(const float* samples, int count);
+    // Write every packet the codec has ready
+    void writePackets(AVCodecContext* ctx, AVStream* stream, AVPacket* pkt);
+
+    void initReadbackBuffers();
+    void initPipeline();
+    void stopPipeline();
+    void readOldestBack();
+
+    // Pipeline stages
+    void convertLoop();
+    void encodeLoop();
+    void convertRGBAFrame(const uint8_t* pixels, AVFrame* frame);
+
+    void setPipelineError(std::exception_ptr error);
+    void rethrowPipelineError();
 
     std::string _filename;
+    ExportSettings _settings;
     int _width, _height;
-    int _fps;
+    AVRational _frameRate;
+    AVPixelFormat _pixFmt = AV_PIX_FMT_YUV420P;
     int _sampleRate;
     int _channels;
 
     AVFormatContext* _fmtCtx = nullptr;
     AVStream* _videoStream = nullptr;
     AVStream* _audioStream = nullptr;
-    AVCodecContext* _videoCtx = nullptr;
+    AVCodecContext* _videoCtx = nullptr;        // Null in stream-copy mode
+    AVCodecParameters* _copiedParams = nullptr; // Stream-copy mode: parameters every appended file must match
     AVCodecContext* _audioCtx = nullptr;
-    SwsContext* _swsCtx = nullptr;
+    std::vector<SwsContext*> _swsSlices;   // One context per horizontal band of the frame
+    std::vector<int> _sliceRows;           // Band boundaries, _swsSlices.size() + 1 rows
     SwrContext* _swrCtx = nullptr;
 
-    AVFrame* _videoFrame = nullptr;
     AVFrame* _audioFrame = nullptr;
     AVPacket* _pkt = nullptr;
+    AVPacket* _videoPkt = nullptr;     // Owned by the encoding thread
 
     int64_t _videoPts = 0;
     int64_t _audioPts = 0;
 
-    std::vector<uint8_t> _rgbBuffer;
+    const float* _audioSamples = nullptr;
+    size_t _audioSampleCount = 0;
+
+    // Ring of pixel pack buffers, frame N is read back while the next ones are rendered
+    static constexpr int READBACK_BUFFER_COUNT = 3;
+    GLuint _readbackBuffers[READBACK_BUFFER_COUNT] = {};
+    int _nextReadback = 0;      // Buffer the next frame is read into
+    int _pendingReadbacks = 0;  // Frames read back but not encoded yet
+
+    // Frame pools, slots travel between the free and filled queues so nothing is allocated per frame
+    static constexpr int PIPELINE_DEPTH = 4;
+    struct QueuedFrame {
+        int slot;
+        int64_t pts;
+    };
+
+    std::vector<std::vector<uint8_t>> _rgbaFrames;
+    BoundedQueue<int> _freeRGBAFrames{PIPELINE_DEPTH};
+    BoundedQueue<QueuedFrame> _rgbaQueue{PIPELINE_DEPTH};
+
+    std::vector<AVFrame*> _yuvFrames;
+    BoundedQueue<int> _freeYUVFrames{PIPELINE_DEPTH};
+    BoundedQueue<QueuedFrame> _yuvQueue{PIPELINE_DEPTH};
+
+    std::thread _convertThread;
+    std::thread _encodeThread;
+
+    std::mutex _muxMutex;       // The audio and video stages share the muxer
+    std::mutex _errorMutex;
+    std::exception_ptr _pipelineError;
 };
 
 // Utility macro for error checking
-inline char err_buf[AV_ERROR_MAX_STRING_SIZE];
+inline thread_local char err_buf[AV_ERROR_MAX_STRING_SIZE];
 #define CHECK_ERR(err) if (err < 0) throw std::runtime_error(av_make_error_string(err_buf, AV_ERROR_MAX_STRING_SIZE, err));
 
 #endif // MP4ENCODER_H
@@ -0,0 +1,70 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "ExportSettings.h"
+
+#include <stdexcept>
+
+ExportSettings makeExportSettings(ExportPreset preset) {
+    ExportSettings settings;
+
+    switch (preset) {
+        case ExportPreset::draft:
+            settings.width = 376;
+            settings.height = 186;
+            settings.framerate = 30.0;
+            settings.crf = 30;
+            settings.preset = "ultrafast";
+            settings.tune = "fastdecode";
+            settings.gop_size = 60;
+            settings.fast_conversion = true;
+            settings.audio_bitrate = 96000;
+            break;
+
+        case ExportPreset::master:
+            settings.width = 1920;
+            settings.height = 948;
+            settings.framerate = 60.0;
+            settings.crf = 18;
+            settings.preset = "slow";
+            settings.tune = "animation";
+            settings.gop_size = 120;
+            break;
+
+        case ExportPreset::lossless:
+            settings.width = 1920;
+            settings.height = 948;
+            settings.framerate = 60.0;
+            settings.codec = VideoCodec::ffv1;
+            settings.crf = -1;
+            settings.bitrate = 0;
+            settings.preset.clear();
+            settings.gop_size = 1;  // Intra only, any frame can be cut
+            break;
+    }
+
+    return settings;
+}
+
+const char* getExportExtension(const ExportSettings &settings) {
+    return settings.codec == VideoCodec::ffv1 ? ".mkv" : ".mp4";
+}
+
+void validateExportSettings(const ExportSettings &settings) {
+    // YUV 4:2:0 needs even dimensions
+    if (settings.width <= 0 || settings.height <= 0 || settings.width % 2 || settings.height % 2)
+        throw std::runtime_error("The export size must be positive and even");
+    if (settings.framerate <= 0)
+        throw std::runtime_error("The framerate must be positive");
+    if (settings.crf > 51)
+        throw std::runtime_error("The crf must be in [0, 51]");
+    if (settings.crf < 0 && settings.codec == VideoCodec::h264 && settings.bitrate <= 0)
+        throw std::runtime_error("Either a crf or a bitrate is required");
+    if (settings.gop_size <= 0)
+        throw std::runtime_error("The GOP size must be positive");
+    if (settings.max_b_frames < -1)
+        throw std::runtime_error("Invalid B-frame count");
+    if (settings.thread_count < 0)
+        throw std::runtime_error("The thread count can't be negative");
+}
@@ -0,0 +1,78 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef EXPORTSETTINGS_H
+#define EXPORTSETTINGS_H
+
+#include <cstdint>
+#include <string>
+
+enum class ExportPreset {
+    draft,      // Quick review: low resolution, ultrafast x264
+    master,     // Final output: full resolution, slow x264 at high quality
+    lossless,   // Intermediate: FFV1 in MKV, fast to write, transcode it later
+};
+
+inline const char* ExportPreset_str [] {
+    "draft",
+    "master",
+    "lossless",
+};
+
+inline ExportPreset ExportPreset_from_int [] {
+    ExportPreset::draft,
+    ExportPreset::master,
+    ExportPreset::lossless,
+};
+
+inline const char* ExportPreset_to_str(const ExportPreset& preset) {
+    switch (preset) {
+        case ExportPreset::draft:
+            return "draft";
+        case ExportPreset::master:
+            return "master";
+        case ExportPreset::lossless:
+            return "lossless";
+    }
+
+    return "";
+}
+
+enum class VideoCodec {
+    h264,   // MP4
+    ffv1,   // MKV, lossless
+};
+
+struct ExportSettings {
+    int width = 750;                // Must be even
+    int height = 370;               // Must be even
+    double framerate = 60.0;
+
+    VideoCodec codec = VideoCodec::h264;
+
+    // Rate control: constant quality when crf >= 0, otherwise constant bitrate
+    int crf = 23;
+    int64_t bitrate = 800000;       // bit/s
+
+    std::string preset = "medium";  // x264 speed preset, ultrafast .. veryslow
+    std::string tune;               // x264 tune, empty for none
+
+    int thread_count = 0;           // Codec threads, 0 lets libavcodec decide
+    int gop_size = 12;              // Keyframe interval in frames
+    int max_b_frames = -1;          // -1 keeps the codec default
+
+    bool fast_conversion = false;   // Faster but less accurate RGBA -> YUV conversion
+
+    int audio_bitrate = 256000;     // bit/s
+};
+
+ExportSettings makeExportSettings(ExportPreset preset);
+
+// ".mp4" or ".mkv"
+const char* getExportExtension(const ExportSettings& settings);
+
+// Throw std::runtime_error if the settings can't be encoded
+void validateExportSettings(const ExportSettings& settings);
+
+#endif //EXPORTSETTINGS_H
@@ -0,0 +1,55 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "FixtureLayout.h"
+
+#include <cmath>
+
+std::vector<Fixture> defaultFixtureLayout() {
+    const float y_top = 0.6f;
+    const float y_mid = 0.0f;
+    const float y_bot = -0.6f;
+
+    const float x_spacing = 0.3f;
+    const glm::vec2 size = {0.12f, 0.36f};
+
+    std::vector<Fixture> fixtures;
+    for (int i = 0; i < 12; ++i) {
+        glm::vec2 pos;
+        if (i < 5) pos = { -0.8f + x_spacing * i,  y_top };
+        else if (i < 7) pos = { -0.2f + x_spacing * (i - 5), y_mid };
+        else pos = { -0.5f + x_spacing * (i - 7), y_bot };
+
+        fixtures.push_back({pos, size});
+    }
+
+    return fixtures;
+}
+
+std::vector<Fixture> gridFixtureLayout(size_t fixture_count) {
+    std::vector<Fixture> fixtures;
+    if (fixture_count == 0) return fixtures;
+
+    const size_t columns = size_t(std::ceil(std::sqrt(double(fixture_count))));
+    const size_t rows = (fixture_count + columns - 1) / columns;
+
+    const glm::vec2 cell = {2.f / columns, 2.f / rows};
+    const glm::vec2 size = cell * 0.8f;
+
+    fixtures.reserve(fixture_count);
+    for (size_t i = 0; i < fixture_count; ++i) {
+        size_t column = i % columns;
+        size_t row = i / columns;
+
+        glm::vec2 pos = {-1.f + cell.x * (column + 0.5f), 1.f - cell.y * (row + 0.5f)};
+        fixtures.push_back({pos, size});
+    }
+
+    return fixtures;
+}
+
+std::vector<Fixture> makeFixtureLayout(size_t fixture_count) {
+    if (fixture_count == 12) return defaultFixtureLayout();
+    return gridFixtureLayout(fixture_count);
+}
@@ -0,0 +1,29 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef FIXTURELAYOUT_H
+#define FIXTURELAYOUT_H
+
+#include <vector>
+
+#include "../libs/glm/glm.hpp"
+
+// Where a light sits in the preview, one per light of the rig
+struct Fixture {
+    glm::vec2 position; // Center, in normalized device coordinates
+    glm::vec2 size;     // Full width and height, in normalized device coordinates
+
+    bool operator==(const Fixture&) const = default;
+};
+
+// The original 12 windows rig, in rows of 5, 2 and 5
+std::vector<Fixture> defaultFixtureLayout();
+
+// Fixtures laid out on a regular grid filling the preview, row by row from the top
+std::vector<Fixture> gridFixtureLayout(size_t fixture_count);
+
+// Default layout for 12 lights, a grid otherwise
+std::vector<Fixture> makeFixtureLayout(size_t fixture_count);
+
+#endif //FIXTURELAYOUT_H
@@ -0,0 +1,244 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "HeadlessExport.h"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "AudioManager.h"
+#include "ProjectFile.h"
+#include "SegmentedExporter.h"
+#include "VideoExporter.h"
+
+namespace {
+    void printUsage() {
+        std::cout << "Usage: ELISE --export <project.elise> <song> <output.mp4|.mkv>" << std::endl
+                  << "    [--preset draft|master|lossless] [--fps N] [--size WxH] [--crf N] [--bitrate N]" << std::endl
+                  << "    [--x264-preset NAME] [--tune NAME] [--threads N] [--gop N]" << std::endl
+                  << "    [--segments N] [--keep-segments] [--only-segments I,J,..]" << std::endl;
+    }
+
+    // Hidden 1x1 window, only used for its GL context
+    GLFWwindow* createOffscreenContext() {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        return glfwCreateWindow(1, 1, "ELISE export", nullptr, nullptr);
+    }
+
+    GLFWwindow* initHeadlessGL() {
+        if (glfwInit()) {
+            if (auto window = createOffscreenContext()) return window;
+            glfwTerminate();
+        }
+
+#if defined(GLFW_PLATFORM_NULL) && defined(GLFW_OSMESA_CONTEXT_API)
+        // No display server (CI, render farm): software context through OSMesa
+        std::cout << "No display available, falling back to OSMesa" << std::endl;
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        if (glfwInit()) {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+            if (auto window = createOffscreenContext()) return window;
+            glfwTerminate();
+        }
+#endif
+        return nullptr;
+    }
+
+    template<typename Exporter>
+    void exportWithProgress(Exporter& exporter) {
+        int last_percent = -1;
+        while (exporter.exportFrame()) {
+            int percent = int(exporter.getProgress() * 100);
+            if (percent != last_percent) {
+                std::cout << "\rExporting: " << percent << "%" << std::flush;
+                last_percent = percent;
+            }
+        }
+    }
+
+    std::vector<Command> collectCommands(const ProjectData& project) {
+        auto keyframes = project.keyframes;
+        std::stable_sort(keyframes.begin(), keyframes.end(), compare);
+
+        std::vector<Command> commands;
+        for (auto& keyframe : keyframes) {
+            if (!keyframe.is_enabled) continue;
+
+            auto found = project.keyframe_uuid_to_commands.find(keyframe.uuid);
+            if (found == project.keyframe_uuid_to_commands.end()) continue;
+
+            for (auto command : found->second) {
+                retimeCommand(command, keyframe.trigger_sample);
+                commands.push_back(command);
+            }
+        }
+        return commands;
+    }
+}
+
+bool parseHeadlessExportArgs(int argc, char **argv, HeadlessExportOptions &options) {
+    if (argc < 2 || std::strcmp(argv[1], "--export") != 0) return false;
+
+    if (argc < 5) {
+        printUsage();
+        throw std::runtime_error("Missing export arguments");
+    }
+
+    options.project_path = argv[2];
+    options.song_path = argv[3];
+    options.output_path = argv[4];
+
+    // The preset is the base every other flag overrides, wherever it is on the command line
+    for (int i = 5; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--preset") != 0) continue;
+
+        bool found = false;
+        for (auto preset : ExportPreset_from_int) {
+            if (std::strcmp(argv[i + 1], ExportPreset_to_str(preset)) == 0) {
+                options.settings = makeExportSettings(preset);
+                found = true;
+            }
+        }
+        if (!found) throw std::runtime_error(std::string("Unknown export preset: ") + argv[i + 1]);
+    }
+
+    auto& settings = options.settings;
+    auto& segmentation = options.segmentation;
+    for (int i = 5; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--keep-segments") {
+            segmentation.keep_segments = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            printUsage();
+            throw std::runtime_error("Missing value for " + flag);
+        }
+        const char* value = argv[++i];
+
+        if (flag == "--preset") {
+            continue;
+        } else if (flag == "--fps") {
+            settings.framerate = std::stod(value);
+        } else if (flag == "--size") {
+            if (std::sscanf(value, "%dx%d", &settings.width, &settings.height) != 2)
+                throw std::runtime_error("Invalid size, expected WxH");
+        } else if (flag == "--crf") {
+            settings.crf = std::stoi(value);
+        } else if (flag == "--bitrate") {
+            settings.bitrate = std::stoll(value);
+            settings.crf = -1;
+        } else if (flag == "--x264-preset") {
+            settings.preset = value;
+        } else if (flag == "--tune") {
+            settings.tune = value;
+        } else if (flag == "--threads") {
+            settings.thread_count = std::stoi(value);
+        } else if (flag == "--gop") {
+            settings.gop_size = std::stoi(value);
+        } else if (flag == "--segments") {
+            segmentation.segment_count = std::stoi(value);
+        } else if (flag == "--only-segments") {
+            std::stringstream list(value);
+            std::string index;
+            while (std::getline(list, index, ',')) segmentation.only_segments.push_back(std::stoi(index));
+            // Redone segments are meant to be redone again later
+            segmentation.keep_segments = true;
+        } else {
+            printUsage();
+            throw std::runtime_error("Unknown export argument: " + flag);
+        }
+    }
+
+    validateExportSettings(settings);
+    if (segmentation.segment_count < 1) throw std::runtime_error("The segment count must be positive");
+    return true;
+}
+
+int runHeadlessExport(const HeadlessExportOptions &options) {
+    auto& segmentation = options.segmentation;
+
+    ProjectData project;
+    try {
+        project = loadProject(options.project_path);
+    } catch (const std::exception& e) {
+        std::cout << "Not a valid ELISE file: " << e.what() << std::endl;
+        return 1;
+    }
+
+    AudioManager audio_manager;
+    if (!audio_manager.loadMP3(options.song_path)) {
+        std::cout << "Unable to load the song: " << options.song_path << std::endl;
+        return 1;
+    }
+    audio_manager.waitUntilLoaded();
+    int sample_rate = audio_manager.getSampleRate();
+
+    GLFWwindow* window = initHeadlessGL();
+    if (!window) {
+        std::cout << "Unable to create an OpenGL context" << std::endl;
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Unable to load OpenGL" << std::endl;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 1;
+    }
+
+    int exit_code = 0;
+    {
+        LightManager light_manager;
+        for (size_t i = 0; i < project.light_count; ++i) light_manager.addLight();
+        for (auto& group : project.groups) light_manager.new_group(group.lights);
+        light_manager.compile(collectCommands(project));
+
+        Odin::Renderer renderer;
+        renderer.InitRenderer(options.settings.width, options.settings.height);
+        renderer.setFixtures(project.fixtures);
+
+        int64_t end_sample = 0;
+        for (auto& keyframe : project.keyframes) end_sample = std::max(end_sample, keyframe.trigger_sample);
+
+        try {
+            auto start = std::chrono::steady_clock::now();
+
+            if (segmentation.segment_count > 1 || !segmentation.only_segments.empty()) {
+                SegmentedExporter exporter(options.output_path, light_manager, renderer,
+                                           audio_manager.getOriginalSamples(), sample_rate,
+                                           options.settings, end_sample, segmentation);
+                exportWithProgress(exporter);
+            } else {
+                VideoExporter exporter(options.output_path, light_manager, renderer,
+                                       audio_manager.getOriginalSamples(), sample_rate,
+                                       options.settings, end_sample);
+                exportWithProgress(exporter);
+            }
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "\rExported in " << elapsed << "s to " << options.output_path << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << std::endl << "Export failed: " << e.what() << std::endl;
+            exit_code = 1;
+        }
+    } // GL objects are released while the context is still alive
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return exit_code;
+}
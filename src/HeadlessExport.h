@@ -0,0 +1,34 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef HEADLESSEXPORT_H
+#define HEADLESSEXPORT_H
+
+#include <string>
+
+#include "ExportSettings.h"
+#include "SegmentedExporter.h"
+
+struct HeadlessExportOptions {
+    std::string project_path;
+    std::string song_path;
+    std::string output_path;
+    ExportSettings settings = makeExportSettings(ExportPreset::master);
+
+    // More than one segment (or a list of segments to redo) switches to the segmented export
+    SegmentedExportOptions segmentation{1};
+};
+
+// Parse `--export <project.elise> <song> <output> [--preset draft|master|lossless] [--fps N] [--size WxH]
+// [--crf N] [--bitrate N] [--x264-preset NAME] [--tune NAME] [--threads N] [--gop N]
+// [--segments N] [--keep-segments] [--only-segments I,J,..]`.
+// The preset is applied first, the other flags override it.
+// Return false if argv does not ask for a headless export
+bool parseHeadlessExportArgs(int argc, char** argv, HeadlessExportOptions& options);
+
+// Export a project to video without any visible window, as fast as the pipeline allows.
+// Return the process exit code
+int runHeadlessExport(const HeadlessExportOptions& options);
+
+#endif //HEADLESSEXPORT_H
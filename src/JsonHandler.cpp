@@ -4,9 +4,30 @@
 
 #include "JsonHandler.h"
 
+#include <charconv>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <string_view>
 
+#include "MappedFile.h"
+
+
+void to_json(json &j, const Fixture &fixture) {
+    j = json{
+        {"x", fixture.position.x},
+        {"y", fixture.position.y},
+        {"width", fixture.size.x},
+        {"height", fixture.size.y}
+    };
+}
+
+void from_json(const json &j, Fixture &fixture) {
+    j.at("x").get_to(fixture.position.x);
+    j.at("y").get_to(fixture.position.y);
+    j.at("width").get_to(fixture.size.x);
+    j.at("height").get_to(fixture.size.y);
+}
 
 void to_json(json &j, const Group &group) {
     j = json{
@@ -226,6 +247,7 @@ void to_json(json &j, const ProjectData &p) {
 
     j = json{
         {"light_count", p.light_count},
+        {"fixtures", p.fixtures},
         {"groups", p.groups},
         {"keyframes", json_keyframes},
         {"max_uuid", p.max_uuid}
@@ -234,7 +256,22 @@ void to_json(json &j, const ProjectData &p) {
 
 void from_json(const json &j, ProjectData &p) {
     j.at("light_count").get_to(p.light_count);
+
+    // Projects saved before fixture layouts use the default rig
+    if (j.contains("fixtures")) j.at("fixtures").get_to(p.fixtures);
+    else p.fixtures = makeFixtureLayout(p.light_count);
+
+    if (p.fixtures.size() != p.light_count) {
+        throw std::runtime_error("Fixture count doesn't match the light count");
+    }
+
     j.at("groups").get_to(p.groups);
+    for (auto& group : p.groups) {
+        for (size_t light : group.lights) {
+            if (light >= p.light_count) throw std::runtime_error("Invalid light in group: " + group.name);
+        }
+    }
+
     j.at("max_uuid").get_to(p.max_uuid);
 
     std::vector<JsonKeyframes> json_keyframes;
@@ -256,30 +293,640 @@ void from_json(const json &j, ProjectData &p) {
     }
 }
 
-ProjectData load(const std::string &path) {
-    std::ifstream file(path);
+namespace {
+    // Decodes a project straight into ProjectData in one pass over the SAX events, without a DOM.
+    // Same rules as from_json: required fields, defaults for the unused animations, any key order.
+    // Unknown keys are skipped. Throws std::runtime_error on anything from_json would reject
+    class ProjectSaxReader : public nlohmann::json_sax<json> {
+    public:
+        ProjectSaxReader(ProjectData& project, std::size_t size_hint) : p(project) {
+            // Rough size of a pretty printed keyframe with a few commands, the vectors grow past it anyway
+            p.keyframes.reserve(size_hint / 2048);
+            p.keyframe_uuid_to_commands.reserve(size_hint / 2048);
+        }
+
+        // Checks that need the whole document
+        void finish() {
+            if (!stack.empty() || !is_root_done) throw std::runtime_error("Not an ELISE project");
+            if (!(root_seen & bit(Field::fixtures))) p.fixtures = makeFixtureLayout(p.light_count);
+
+            if (p.fixtures.size() != p.light_count) {
+                throw std::runtime_error("Fixture count doesn't match the light count");
+            }
+
+            for (auto& group : p.groups) {
+                for (size_t light : group.lights) {
+                    if (light >= p.light_count) throw std::runtime_error("Invalid light in group: " + group.name);
+                }
+            }
+        }
+
+        bool null() override {
+            return unexpected();
+        }
+
+        bool boolean(bool val) override {
+            if (top() == Node::toggle && field == Field::is_on) command().animation.toggle.is_on = val;
+            else return unexpected();
+            return seen();
+        }
+
+        bool number_integer(number_integer_t val) override {
+            return number(val, double(val));
+        }
+
+        bool number_unsigned(number_unsigned_t val) override {
+            return number(int64_t(val), double(val));
+        }
+
+        bool number_float(number_float_t val, const string_t&) override {
+            return number(int64_t(val), val);
+        }
+
+        bool string(string_t& val) override {
+            if (top() == Node::group && field == Field::name) {
+                p.groups.back().name = std::move(val);
+            } else if (top() == Node::animation && field == Field::kind) {
+                json(std::move(val)).get_to(command().animation.kind);
+            } else if (top() == Node::gradient && field == Field::kind) {
+                json(std::move(val)).get_to(command().animation.gradient.kind);
+            } else {
+                return unexpected();
+            }
+            return seen();
+        }
+
+        bool start_object(std::size_t) override {
+            Node node = Node::skipped;
+
+            if (stack.empty()) {
+                node = Node::root;
+            } else {
+                switch (top()) {
+                    case Node::fixtures: node = Node::fixture; p.fixtures.emplace_back(); break;
+                    case Node::groups: node = Node::group; p.groups.emplace_back(); break;
+                    case Node::keyframes: node = Node::keyframe; startKeyframe(); break;
+                    case Node::commands: node = Node::command; commands->emplace_back(); break;
+                    case Node::command: if (field == Field::animation) node = Node::animation; break;
+                    case Node::animation:
+                        if (field == Field::toggle) node = Node::toggle;
+                        else if (field == Field::gradient) node = Node::gradient;
+                        else if (field == Field::blink) node = Node::blink;
+                        break;
+                    case Node::toggle:
+                    case Node::gradient:
+                    case Node::blink:
+                        color = colorTarget(top());
+                        if (color) node = Node::color;
+                        break;
+                    default: break;
+                }
+                if (node == Node::skipped) unexpected();
+                seen();
+            }
+
+            stack.push_back({node, 0});
+            return true;
+        }
+
+        bool key(string_t& val) override {
+            static constexpr std::pair<std::string_view, Field> fields[] = {
+                {"light_count", Field::light_count}, {"fixtures", Field::fixtures}, {"groups", Field::groups},
+                {"keyframes", Field::keyframes}, {"max_uuid", Field::max_uuid},
+                {"x", Field::x}, {"y", Field::y}, {"width", Field::width}, {"height", Field::height},
+                {"name", Field::name}, {"lights", Field::lights},
+                {"trigger_sample", Field::trigger_sample}, {"commands", Field::commands},
+                {"animation", Field::animation}, {"group_id", Field::group_id},
+                {"kind", Field::kind}, {"toggle", Field::toggle}, {"gradient", Field::gradient}, {"blink", Field::blink},
+                {"is_on", Field::is_on}, {"color", Field::color},
+                {"start_color", Field::start_color}, {"end_color", Field::end_color},
+                {"on_color", Field::on_color}, {"off_color", Field::off_color},
+                {"duration", Field::duration}, {"period", Field::period},
+                {"r", Field::r}, {"g", Field::g}, {"b", Field::b}, {"a", Field::a},
+            };
+
+            // A handful of short keys: comparing the length first rejects almost every entry
+            field = Field::none;
+            for (auto& [name, value] : fields) {
+                if (name.size() == val.size() && name == val) {
+                    field = value;
+                    break;
+                }
+            }
+            return true;
+        }
+
+        bool end_object() override {
+            auto frame = stack.back();
+            stack.pop_back();
+            if (frame.node == Node::skipped) return true;
+
+            if ((frame.seen & required(frame.node)) != required(frame.node)) {
+                throw std::runtime_error("Missing field in project " + std::string(nodeName(frame.node)));
+            }
+
+            if (frame.node == Node::animation) endAnimation(frame.seen);
+            if (frame.node == Node::root) is_root_done = true;
+            return true;
+        }
+
+        bool start_array(std::size_t) override {
+            Node node = Node::skipped;
+
+            if (!stack.empty()) {
+                if (top() == Node::root && field == Field::fixtures) {
+                    node = Node::fixtures;
+                    p.fixtures.clear();
+                } else if (top() == Node::root && field == Field::groups) {
+                    node = Node::groups;
+                } else if (top() == Node::root && field == Field::keyframes) {
+                    node = Node::keyframes;
+                } else if (top() == Node::group && field == Field::lights) {
+                    node = Node::group_lights;
+                } else if (top() == Node::keyframe && field == Field::commands) {
+                    node = Node::commands;
+                }
+                if (node == Node::skipped) unexpected();
+                seen();
+            } else {
+                unexpected();
+            }
+
+            stack.push_back({node, 0});
+            return true;
+        }
+
+        bool end_array() override {
+            stack.pop_back();
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+            throw std::runtime_error(ex.what());
+        }
+
+    private:
+        enum class Node : uint8_t {
+            root, fixtures, fixture, groups, group, group_lights, keyframes, keyframe, commands, command,
+            animation, toggle, gradient, blink, color, skipped
+        };
+
+        enum class Field : uint8_t {
+            none, light_count, fixtures, groups, keyframes, max_uuid, x, y, width, height, name, lights,
+            trigger_sample, commands, animation, group_id, kind, toggle, gradient, blink, is_on, color,
+            start_color, end_color, on_color, off_color, duration, period, r, g, b, a
+        };
+
+        struct Frame {
+            Node node;
+            uint64_t seen;  // Bit per field, to check the required ones
+        };
+
+        static constexpr uint64_t bit(Field field) {
+            return uint64_t(1) << uint64_t(field);
+        }
+
+        static uint64_t required(Node node) {
+            switch (node) {
+                case Node::root: return bit(Field::light_count) | bit(Field::groups) | bit(Field::keyframes) | bit(Field::max_uuid);
+                case Node::fixture: return bit(Field::x) | bit(Field::y) | bit(Field::width) | bit(Field::height);
+                case Node::group: return bit(Field::name) | bit(Field::lights);
+                case Node::keyframe: return bit(Field::trigger_sample) | bit(Field::commands);
+                case Node::command: return bit(Field::animation) | bit(Field::trigger_sample) | bit(Field::group_id);
+                case Node::animation: return bit(Field::kind);
+                case Node::toggle: return bit(Field::is_on) | bit(Field::color);
+                case Node::gradient: return bit(Field::start_color) | bit(Field::end_color) | bit(Field::kind) | bit(Field::duration);
+                case Node::blink: return bit(Field::on_color) | bit(Field::off_color) | bit(Field::period);
+                case Node::color: return bit(Field::r) | bit(Field::g) | bit(Field::b) | bit(Field::a);
+                default: return 0;
+            }
+        }
+
+        static const char* nodeName(Node node) {
+            switch (node) {
+                case Node::root: return "root";
+                case Node::fixture: return "fixture";
+                case Node::group: return "group";
+                case Node::keyframe: return "keyframe";
+                case Node::command: return "command";
+                case Node::animation: return "animation";
+                case Node::toggle: return "toggle";
+                case Node::gradient: return "gradient";
+                case Node::blink: return "blink";
+                case Node::color: return "color";
+                default: return "value";
+            }
+        }
+
+        Node top() const {
+            return stack.empty() ? Node::skipped : stack.back().node;
+        }
+
+        Command& command() {
+            return commands->back();
+        }
+
+        // Mark the current field of the current object as present
+        bool seen() {
+            if (!stack.empty()) {
+                stack.back().seen |= bit(field);
+                if (stack.back().node == Node::root) root_seen |= bit(field);
+            }
+            return true;
+        }
+
+        // Values of unknown keys are ignored, a known key with the wrong type is an error
+        bool unexpected() const {
+            if (top() == Node::skipped || (field == Field::none && top() != Node::fixtures && top() != Node::groups
+                && top() != Node::keyframes && top() != Node::commands && top() != Node::group_lights)) {
+                return true;
+            }
+            throw std::runtime_error(std::string("Unexpected value in project ") + nodeName(top()));
+        }
+
+        bool number(int64_t integer, double real) {
+            switch (top()) {
+                case Node::root:
+                    if (field == Field::light_count) p.light_count = size_t(integer);
+                    else if (field == Field::max_uuid) p.max_uuid = integer;
+                    else return unexpected();
+                    break;
+
+                case Node::fixture: {
+                    auto& fixture = p.fixtures.back();
+                    if (field == Field::x) fixture.position.x = float(real);
+                    else if (field == Field::y) fixture.position.y = float(real);
+                    else if (field == Field::width) fixture.size.x = float(real);
+                    else if (field == Field::height) fixture.size.y = float(real);
+                    else return unexpected();
+                    break;
+                }
+
+                case Node::group_lights:
+                    p.groups.back().lights.push_back(size_t(integer));
+                    return true;
+
+                case Node::keyframe:
+                    if (field == Field::trigger_sample) p.keyframes.back().trigger_sample = integer;
+                    else return unexpected();
+                    break;
+
+                case Node::command:
+                    if (field == Field::trigger_sample) command().trigger_sample = integer;
+                    else if (field == Field::group_id) command().group_id = int(integer);
+                    else return unexpected();
+                    break;
+
+                case Node::gradient:
+                    if (field == Field::duration) command().animation.gradient.duration = (unsigned int)integer;
+                    else return unexpected();
+                    break;
+
+                case Node::blink:
+                    if (field == Field::period) command().animation.blink.period = integer;
+                    else return unexpected();
+                    break;
+
+                case Node::color:
+                    if (field == Field::r) color->r = int(integer);
+                    else if (field == Field::g) color->g = int(integer);
+                    else if (field == Field::b) color->b = int(integer);
+                    else if (field == Field::a) color->a = int(integer);
+                    else return unexpected();
+                    break;
+
+                default:
+                    return unexpected();
+            }
+            return seen();
+        }
+
+        void startKeyframe() {
+            Keyframe keyframe;
+            keyframe.is_locked = true;
+            keyframe.is_enabled = true;
+            keyframe.trigger_sample = 0;
+            keyframe.uuid = int64_t(p.keyframes.size());
+            p.keyframes.push_back(keyframe);
+
+            // Map nodes never move, the commands are decoded in place
+            commands = &p.keyframe_uuid_to_commands[keyframe.uuid];
+        }
+
+        Color* colorTarget(Node node) {
+            auto& animation = command().animation;
+            switch (node) {
+                case Node::toggle: return field == Field::color ? &animation.toggle.color : nullptr;
+                case Node::gradient:
+                    if (field == Field::start_color) return &animation.gradient.start_color;
+                    if (field == Field::end_color) return &animation.gradient.end_color;
+                    return nullptr;
+                case Node::blink:
+                    if (field == Field::on_color) return &animation.blink.on_color;
+                    if (field == Field::off_color) return &animation.blink.off_color;
+                    return nullptr;
+                default: return nullptr;
+            }
+        }
+
+        void endAnimation(uint64_t fields) {
+            auto& animation = command().animation;
+
+            // The info of the animation kind is required, the other ones are reset like from_json does
+            const Field info = animation.kind == AnimationKind::gradient ? Field::gradient
+                             : animation.kind == AnimationKind::blink ? Field::blink : Field::toggle;
+            if (!(fields & bit(info))) throw std::runtime_error("Missing field in project animation");
+
+            if (info != Field::toggle) animation.toggle = ToggleInfo{false, Color{0, 0, 0, 255}};
+            if (info != Field::gradient) animation.gradient = GradientInfo{Color{0, 0, 0, 255}, Color{0, 0, 0, 255}, GradientKind::linear, 0};
+            if (info != Field::blink) animation.blink = BlinkInfo{Color{0, 0, 0, 255}, Color{0, 0, 0, 255}, 0};
+        }
+
+        ProjectData& p;
+        std::vector<Frame> stack;
+        Field field = Field::none;
+        uint64_t root_seen = 0;
+        bool is_root_done = false;
+
+        std::vector<Command>* commands = nullptr;
+        Color* color = nullptr;
+    };
+}
+
+namespace {
+    // Minimal JSON reader feeding a SAX handler. Saved projects are mostly indentation, this skips it in a
+    // tight loop where the generic lexer pays an indirect call per character. Strict JSON, throws on errors
+    class JsonPullParser {
+    public:
+        JsonPullParser(const char* begin, const char* end) : begin(begin), cursor(begin), end(end) {}
+
+        void parse(nlohmann::json_sax<json>& sax) {
+            skipWhitespace();
+            parseValue(sax, 0);
+            skipWhitespace();
+            if (cursor != end) fail("unexpected data after the document");
+        }
+
+    private:
+        static constexpr int max_depth = 256;
+
+        void parseValue(nlohmann::json_sax<json>& sax, int depth) {
+            if (depth > max_depth) fail("nesting too deep");
+
+            switch (peek()) {
+                case '{': {
+                    ++cursor;
+                    sax.start_object(std::size_t(-1));
+                    skipWhitespace();
+                    if (peek() == '}') {
+                        ++cursor;
+                        sax.end_object();
+                        return;
+                    }
+
+                    while (true) {
+                        skipWhitespace();
+                        expect('"');
+                        parseString();
+                        sax.key(buffer);
+
+                        skipWhitespace();
+                        expect(':');
+                        skipWhitespace();
+                        parseValue(sax, depth + 1);
+
+                        skipWhitespace();
+                        if (peek() == ',') {
+                            ++cursor;
+                            continue;
+                        }
+                        expect('}');
+                        break;
+                    }
+                    sax.end_object();
+                    return;
+                }
+
+                case '[': {
+                    ++cursor;
+                    sax.start_array(std::size_t(-1));
+                    skipWhitespace();
+                    if (peek() == ']') {
+                        ++cursor;
+                        sax.end_array();
+                        return;
+                    }
+
+                    while (true) {
+                        skipWhitespace();
+                        parseValue(sax, depth + 1);
+
+                        skipWhitespace();
+                        if (peek() == ',') {
+                            ++cursor;
+                            continue;
+                        }
+                        expect(']');
+                        break;
+                    }
+                    sax.end_array();
+                    return;
+                }
+
+                case '"':
+                    ++cursor;
+                    parseString();
+                    sax.string(buffer);
+                    return;
+
+                case 't':
+                    literal("true");
+                    sax.boolean(true);
+                    return;
+
+                case 'f':
+                    literal("false");
+                    sax.boolean(false);
+                    return;
+
+                case 'n':
+                    literal("null");
+                    sax.null();
+                    return;
+
+                default:
+                    parseNumber(sax);
+                    return;
+            }
+        }
+
+        // After the opening quote, leaves the decoded string in buffer
+        void parseString() {
+            buffer.clear();
+
+            while (true) {
+                const char* run = cursor;
+                while (cursor != end && *cursor != '"' && *cursor != '\\' && (unsigned char)*cursor >= 0x20) ++cursor;
+                buffer.append(run, cursor);
+
+                if (cursor == end) fail("unterminated string");
+                if (*cursor == '"') {
+                    ++cursor;
+                    return;
+                }
+                if (*cursor != '\\') fail("control character in string");
+
+                ++cursor;
+                switch (peek()) {
+                    case '"': buffer.push_back('"'); break;
+                    case '\\': buffer.push_back('\\'); break;
+                    case '/': buffer.push_back('/'); break;
+                    case 'b': buffer.push_back('\b'); break;
+                    case 'f': buffer.push_back('\f'); break;
+                    case 'n': buffer.push_back('\n'); break;
+                    case 'r': buffer.push_back('\r'); break;
+                    case 't': buffer.push_back('\t'); break;
+                    case 'u': {
+                        ++cursor;
+                        uint32_t code_point = parseHex4();
+                        if (code_point >= 0xD800 && code_point < 0xDC00) {
+                            // High surrogate, the low one must follow
+                            if (end - cursor < 2 || cursor[0] != '\\' || cursor[1] != 'u') fail("invalid surrogate pair");
+                            cursor += 2;
+                            uint32_t low = parseHex4();
+                            if (low < 0xDC00 || low >= 0xE000) fail("invalid surrogate pair");
+                            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                        } else if (code_point >= 0xDC00 && code_point < 0xE000) {
+                            fail("invalid surrogate pair");
+                        }
+                        appendUtf8(code_point);
+                        continue;
+                    }
+                    default: fail("invalid escape");
+                }
+                ++cursor;
+            }
+        }
+
+        uint32_t parseHex4() {
+            if (end - cursor < 4) fail("invalid unicode escape");
+            uint32_t value = 0;
+            auto result = std::from_chars(cursor, cursor + 4, value, 16);
+            if (result.ptr != cursor + 4) fail("invalid unicode escape");
+            cursor += 4;
+            return value;
+        }
+
+        void appendUtf8(uint32_t code_point) {
+            if (code_point < 0x80) {
+                buffer.push_back(char(code_point));
+            } else if (code_point < 0x800) {
+                buffer.push_back(char(0xC0 | (code_point >> 6)));
+                buffer.push_back(char(0x80 | (code_point & 0x3F)));
+            } else if (code_point < 0x10000) {
+                buffer.push_back(char(0xE0 | (code_point >> 12)));
+                buffer.push_back(char(0x80 | ((code_point >> 6) & 0x3F)));
+                buffer.push_back(char(0x80 | (code_point & 0x3F)));
+            } else {
+                buffer.push_back(char(0xF0 | (code_point >> 18)));
+                buffer.push_back(char(0x80 | ((code_point >> 12) & 0x3F)));
+                buffer.push_back(char(0x80 | ((code_point >> 6) & 0x3F)));
+                buffer.push_back(char(0x80 | (code_point & 0x3F)));
+            }
+        }
+
+        void parseNumber(nlohmann::json_sax<json>& sax) {
+            const char* start = cursor;
+            bool is_float = false;
+            while (cursor != end) {
+                char c = *cursor;
+                if (c == '.' || c == 'e' || c == 'E') is_float = true;
+                else if (!(c == '-' || c == '+' || (c >= '0' && c <= '9'))) break;
+                ++cursor;
+            }
+            if (cursor == start) fail("unexpected character");
+
+            std::from_chars_result result{};
+            if (is_float) {
+                double value = 0.0;
+                result = std::from_chars(start, cursor, value);
+                if (result.ptr == cursor && result.ec == std::errc()) sax.number_float(value, buffer);
+            } else if (*start == '-') {
+                int64_t value = 0;
+                result = std::from_chars(start, cursor, value);
+                if (result.ptr == cursor && result.ec == std::errc()) sax.number_integer(value);
+            } else {
+                uint64_t value = 0;
+                result = std::from_chars(start, cursor, value);
+                if (result.ptr == cursor && result.ec == std::errc()) sax.number_unsigned(value);
+            }
+            if (result.ptr != cursor || result.ec != std::errc()) fail("invalid number");
+        }
+
+        void literal(std::string_view word) {
+            if (std::size_t(end - cursor) < word.size() || std::string_view(cursor, word.size()) != word) fail("unexpected character");
+            cursor += word.size();
+        }
+
+        void skipWhitespace() {
+            while (cursor != end) {
+                // Indentation comes in long runs of spaces, eight at a time
+                uint64_t word;
+                while (end - cursor >= 8 && (std::memcpy(&word, cursor, 8), word == 0x2020202020202020ull)) cursor += 8;
+
+                char c = *cursor;
+                if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return;
+                ++cursor;
+            }
+        }
+
+        char peek() {
+            if (cursor == end) fail("unexpected end of file");
+            return *cursor;
+        }
+
+        void expect(char c) {
+            if (peek() != c) fail(std::string("expected '") + c + "'");
+            ++cursor;
+        }
+
+        [[noreturn]] void fail(const std::string& message) const {
+            throw std::runtime_error("Invalid JSON at byte " + std::to_string(cursor - begin) + ": " + message);
+        }
+
+        const char* begin;
+        const char* cursor;
+        const char* end;
+        std::string buffer;  // Last string or key, reused
+    };
+}
 
+ProjectData loadJson(const std::string &path) {
     ProjectData p;
-    json j;
 
-    if (!file.is_open()) {
-        std::cout << "Failed to open file " << path << std::endl;
-        p = json::object();
+    try {
+        // Parsed straight from the mapped bytes, the file is never copied
+        MappedFile file(path);
+        auto bytes = file.bytes();
+        const char* begin = reinterpret_cast<const char*>(bytes.data());
+
+        ProjectSaxReader reader(p, bytes.size());
+        JsonPullParser(begin, begin + bytes.size()).parse(reader);
+        reader.finish();
+    } catch (const std::exception& e) {
+        std::cout << "Failed to load json file " << path << ": " << e.what() << std::endl;
+        throw;
     }
 
-    try {
-        file >> j;
-        p = j;
-    } catch (const json::parse_error& e) {
-        std::cout << "Failed to parse json file " << path << std::endl;
-        p = json::object();
+    // The animations start with their command, the start samples are not stored
+    for (auto& [uuid, commands] : p.keyframe_uuid_to_commands) {
+        for (auto& command : commands) retimeCommand(command, command.trigger_sample);
     }
 
-    file.close();
     return p;
 }
 
-void save(const std::string &path, const ProjectData &data) {
+void saveJson(const std::string &path, const ProjectData &data) {
     std::ofstream file(path);
 
     if (!file.is_open()) {
@@ -7,9 +7,11 @@
 
 #include "../libs/nlohmann/json.hpp"
 #include "LightManager.h"
+#include "FixtureLayout.h"
 
 struct ProjectData {
     size_t light_count = 12;
+    std::vector<Fixture> fixtures = defaultFixtureLayout();
     int sample_rate = 44100;
     std::vector<Group> groups;
     std::vector<Keyframe> keyframes;
@@ -24,6 +26,9 @@ struct JsonKeyframes {
 
 using json = nlohmann::json;
 
+void to_json(json& j, const Fixture& fixture);
+void from_json(const json& j, Fixture& fixture);
+
 void to_json(json& j, const Group& group);
 void from_json(const json& j, Group& group);
 
@@ -58,8 +63,9 @@ void from_json(const json& j, JsonKeyframes& k);
 void to_json(json& j, const ProjectData& p);
 void from_json(const json& j, ProjectData& p);
 
-ProjectData load(const std::string& path);
-void save(const std::string& path, const ProjectData& data);
+// JSON import/export, for interchange. Projects are saved in the binary format, see ProjectFile.h
+ProjectData loadJson(const std::string& path);
+void saveJson(const std::string& path, const ProjectData& data);
 
 
 #endif //JSONHANDLER_H
@@ -0,0 +1,99 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "KeyframeStore.h"
+
+#include <limits>
+#include <stdexcept>
+
+void KeyframeStore::assign(const std::vector<Keyframe> &keyframes) {
+    clear();
+    for (auto& keyframe : keyframes) insert(keyframe);
+}
+
+void KeyframeStore::clear() {
+    keyframes.clear();
+    uuid_to_keyframe.clear();
+}
+
+bool KeyframeStore::insert(const Keyframe &keyframe) {
+    if (uuid_to_keyframe.contains(keyframe.uuid)) return false;
+
+    auto [it, inserted] = keyframes.emplace(Key{keyframe.trigger_sample, keyframe.uuid}, keyframe);
+    uuid_to_keyframe[keyframe.uuid] = it;
+    return inserted;
+}
+
+bool KeyframeStore::erase(int64_t uuid) {
+    auto found = uuid_to_keyframe.find(uuid);
+    if (found == uuid_to_keyframe.end()) return false;
+
+    keyframes.erase(found->second);
+    uuid_to_keyframe.erase(found);
+    return true;
+}
+
+bool KeyframeStore::move(int64_t uuid, int64_t trigger_sample) {
+    auto found = uuid_to_keyframe.find(uuid);
+    if (found == uuid_to_keyframe.end()) return false;
+    if (found->second->first.first == trigger_sample) return true;
+
+    // Re-key the node in place instead of copying the keyframe
+    auto node = keyframes.extract(found->second);
+    node.key().first = trigger_sample;
+    node.mapped().trigger_sample = trigger_sample;
+    found->second = keyframes.insert(std::move(node)).position;
+    return true;
+}
+
+bool KeyframeStore::contains(int64_t uuid) const {
+    return uuid_to_keyframe.contains(uuid);
+}
+
+Keyframe & KeyframeStore::at(int64_t uuid) {
+    auto found = uuid_to_keyframe.find(uuid);
+    if (found == uuid_to_keyframe.end()) throw std::out_of_range("Unknown keyframe uuid");
+    return found->second->second;
+}
+
+const Keyframe & KeyframeStore::at(int64_t uuid) const {
+    auto found = uuid_to_keyframe.find(uuid);
+    if (found == uuid_to_keyframe.end()) throw std::out_of_range("Unknown keyframe uuid");
+    return found->second->second;
+}
+
+size_t KeyframeStore::size() const {
+    return keyframes.size();
+}
+
+bool KeyframeStore::empty() const {
+    return keyframes.empty();
+}
+
+KeyframeStore::const_iterator KeyframeStore::begin() const {
+    return keyframes.begin();
+}
+
+KeyframeStore::const_iterator KeyframeStore::end() const {
+    return keyframes.end();
+}
+
+KeyframeStore::const_iterator KeyframeStore::lower_bound(int64_t sample) const {
+    return keyframes.lower_bound(Key{sample, std::numeric_limits<int64_t>::min()});
+}
+
+KeyframeStore::const_iterator KeyframeStore::upper_bound(int64_t sample) const {
+    return keyframes.upper_bound(Key{sample, std::numeric_limits<int64_t>::max()});
+}
+
+const Keyframe & KeyframeStore::back() const {
+    return keyframes.rbegin()->second;
+}
+
+std::vector<Keyframe> KeyframeStore::toVector() const {
+    std::vector<Keyframe> result;
+    result.reserve(keyframes.size());
+    for (auto& [key, keyframe] : keyframes) result.push_back(keyframe);
+    return result;
+}
@@ -0,0 +1,60 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef KEYFRAMESTORE_H
+#define KEYFRAMESTORE_H
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LightManager.h"
+
+// Keyframes kept sorted by trigger sample, with an uuid index on the side.
+// Insert, move and delete are O(log n), so editing a keyframe never re-sorts the whole show.
+class KeyframeStore {
+public:
+    using Key = std::pair<int64_t, int64_t>; // (trigger_sample, uuid), the uuid breaks ties
+    using Container = std::map<Key, Keyframe>;
+    using const_iterator = Container::const_iterator;
+
+    void assign(const std::vector<Keyframe>& keyframes);
+    void clear();
+
+    // Return false if a keyframe with the same uuid already exists
+    bool insert(const Keyframe& keyframe);
+    bool erase(int64_t uuid);
+    bool move(int64_t uuid, int64_t trigger_sample);
+
+    bool contains(int64_t uuid) const;
+
+    // The trigger sample must not be modified through this reference, use move() instead
+    Keyframe& at(int64_t uuid);
+    const Keyframe& at(int64_t uuid) const;
+
+    size_t size() const;
+    bool empty() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // First keyframe triggered at or after `sample`
+    const_iterator lower_bound(int64_t sample) const;
+    // First keyframe triggered strictly after `sample`
+    const_iterator upper_bound(int64_t sample) const;
+
+    const Keyframe& back() const;
+
+    std::vector<Keyframe> toVector() const;
+
+private:
+    Container keyframes;
+    std::unordered_map<int64_t, Container::iterator> uuid_to_keyframe;
+};
+
+
+
+#endif //KEYFRAMESTORE_H
@@ -5,8 +5,12 @@
 #include "LightManager.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 
+#include "LightStateEngine.h"
+#include "Timeline.h"
+
 ImVec4 get_vec(const Color &col) {
     return ImVec4(col.r / 255.f, col.g / 255.f, col.b / 255.f, col.a / 255.f);
 }
@@ -83,17 +87,42 @@ Color computeAnimationColor(const AnimationDesc &animation, int64_t sample) {
     }
 }
 
-LightManager::LightManager() {
+namespace {
+    // Active segment of a light that hasn't been looked up in the timeline yet
+    constexpr std::ptrdiff_t unknown_segment = -2;
+}
+
+LightManager::LightManager() : timeline(std::make_shared<Timeline>()), light_states(std::make_unique<LightStateEngine>()) {
+
+}
 
+LightManager::LightManager(const LightManager &other)
+    : group_ids(other.group_ids),
+      timeline(other.timeline),
+      timeline_version(other.timeline_version),
+      active_segments(other.active_segments),
+      light_states(std::make_unique<LightStateEngine>(*other.light_states)),
+      light_colors(other.light_colors) {
 }
 
+LightManager::~LightManager() = default;
+
 int LightManager::addLight() {
-    auto light_id = lights.size();
-    lights.push_back(AnimationDesc{});
-    light_states.push_back(Color{0, 0, 0, 255});
+    auto light_id = active_segments.size();
+    active_segments.push_back(unknown_segment);
+    light_colors.push_back(glm::vec4(0.f, 0.f, 0.f, 1.f));
+    light_states->resize(active_segments.size());
     return light_id;
 }
 
+void LightManager::clear() {
+    editTimeline().clear();
+    group_ids.clear();
+    active_segments.clear();
+    light_colors.clear();
+    light_states->resize(0);
+}
+
 int LightManager::new_group(std::vector<size_t> light_ids) {
     auto group_id = group_ids.size();
     group_ids.push_back(light_ids);
@@ -106,41 +135,66 @@ void LightManager::update(int64_t current_sample) {
 }
 
 void LightManager::updateAnimations(int64_t current_sample) {
+    if (timeline->lightCount() != active_segments.size()) return;
 
-    while (!commands.empty() && commands.back().trigger_sample <= current_sample) {
-        auto command = commands.back();
-        const auto& animation = command.animation;
+    // Any edit of the timeline may have shifted the segments
+    if (timeline->getVersion() != timeline_version) {
+        std::fill(active_segments.begin(), active_segments.end(), unknown_segment);
+        timeline_version = timeline->getVersion();
+    }
 
-        for (int light_id : group_ids.at(command.group_id)) {
-            lights.at(light_id) = command.animation;
-        }
+    // Only lights entering a new segment are moved to another batch
+    for (size_t light_id = 0; light_id < active_segments.size(); ++light_id) {
+        auto segment = timeline->segmentIndexAt(light_id, current_sample);
+        if (segment == active_segments[light_id]) continue;
 
-        commands.pop_back();
+        active_segments[light_id] = segment;
+        light_states->setAnimation(light_id, timeline->animationAt(light_id, current_sample));
     }
 }
 
 void LightManager::updateLightStates(int64_t current_sample) {
-    for (int i = 0; i < light_states.size(); i++) {
-        light_states[i] = computeAnimationColor(lights.at(i), current_sample);
-    }
+    light_states->evaluate(current_sample, light_colors.data());
 }
 
-void LightManager::setCommandStack(const std::vector<Command> &commands) {
-    this->commands = commands;
+void LightManager::compile(const std::vector<Command> &commands) {
+    editTimeline().compile(commands, group_ids, active_segments.size());
 }
 
-void LightManager::reset() {
-    for (auto& light : lights) {
-        light = AnimationDesc{};
+void LightManager::patch(int64_t from, int64_t to, const std::vector<int> &groups, const std::vector<Command> &commands) {
+    if (timeline->lightCount() != active_segments.size()) return;
+
+    std::vector<size_t> patched_lights;
+    for (int group_id : groups) {
+        auto& ids = group_ids.at(group_id);
+        patched_lights.insert(patched_lights.end(), ids.begin(), ids.end());
     }
-    for (auto& light_state : light_states) {
-        light_state = Color{0, 0, 0, 255};
+
+    std::sort(patched_lights.begin(), patched_lights.end());
+    patched_lights.erase(std::unique(patched_lights.begin(), patched_lights.end()), patched_lights.end());
+
+    editTimeline().patch(from, to, patched_lights, commands, group_ids);
+}
+
+void LightManager::reset() {
+    for (size_t light_id = 0; light_id < active_segments.size(); ++light_id) {
+        active_segments[light_id] = unknown_segment;
+        light_states->setAnimation(light_id, AnimationDesc{});
+        light_colors[light_id] = glm::vec4(0.f, 0.f, 0.f, 1.f);
     }
 
-    commands.clear();
+    editTimeline().clear();
 }
 
 
-const std::vector<Color> & LightManager::getLightStates() {
-    return light_states;
+const std::vector<glm::vec4> & LightManager::getLightColors() const {
+    return light_colors;
+}
+
+Timeline & LightManager::editTimeline() {
+    // Copies are only made on this thread, so the count can only drop behind our back. When it does, the
+    // fence orders our writes after the reads of the thread that dropped the last copy (see CommandStore)
+    if (timeline.use_count() > 1) timeline = std::make_shared<Timeline>(*timeline);
+    else std::atomic_thread_fence(std::memory_order_acquire);
+    return *timeline;
 }
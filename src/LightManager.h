@@ -4,11 +4,13 @@
 
 #ifndef LIGHTMANAGER_H
 #define LIGHTMANAGER_H
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "imgui.h"
 #include "InterpolationUtils.h"
+#include "../libs/glm/glm.hpp"
 
 struct Group {
     std::string name;
@@ -20,6 +22,8 @@ struct Color {
     int g = 0;
     int b = 0;
     int a = 255;
+
+    bool operator==(const Color&) const = default;
 };
 
 ImVec4 get_vec(const Color& col);
@@ -108,6 +112,8 @@ struct GradientInfo {
 
     int64_t start_sample;
     unsigned int duration; // In sample count
+
+    bool operator==(const GradientInfo&) const = default;
 };
 
 Color computeGradientColor(const GradientInfo& gradient, int64_t sample);
@@ -115,6 +121,8 @@ Color computeGradientColor(const GradientInfo& gradient, int64_t sample);
 struct ToggleInfo {
     bool is_on = true;
     Color color;
+
+    bool operator==(const ToggleInfo&) const = default;
 };
 
 Color computeToggleColor(const ToggleInfo& toggle, int64_t sample);
@@ -124,6 +132,8 @@ struct BlinkInfo {
     Color off_color;
     int64_t start_sample;
     int64_t period; // In sample count
+
+    bool operator==(const BlinkInfo&) const = default;
 };
 
 Color computeBlinkColor(const BlinkInfo& blink, int64_t sample);
@@ -135,12 +145,15 @@ struct AnimationDesc {
     ToggleInfo toggle;
     BlinkInfo blink;
 
+    bool operator==(const AnimationDesc&) const = default;
 };
 
 struct Command {
     AnimationDesc animation;
     int64_t trigger_sample;
     int group_id;
+
+    bool operator==(const Command&) const = default;
 };
 
 struct Keyframe {
@@ -157,14 +170,24 @@ inline bool compare(const Keyframe& a, const Keyframe& b) {
 
 void retimeCommand(Command& command, int64_t current_sample);
 
-Color computeAnimationColor(const AnimationDesc& animation, int sample);
+Color computeAnimationColor(const AnimationDesc& animation, int64_t sample);
+
+class Timeline;
+class LightStateEngine;
 
 class LightManager {
 public:
     LightManager();
+    // The copy shares the compiled show until one of them edits it, and plays it independently
+    LightManager(const LightManager& other);
+    LightManager& operator=(const LightManager&) = delete;
+    ~LightManager();
 
     int addLight();
 
+    // Remove every light and group
+    void clear();
+
     int new_group(std::vector<size_t> light_ids);
 
     void update(int64_t current_sample);
@@ -173,20 +196,29 @@ public:
 
     void updateLightStates(int64_t current_sample);
 
-    // Must be ordered by trigger time. The last at [0], the first at [size-1]
-    void setCommandStack(const std::vector<Command>& commands);
+    // Must be ordered by trigger time
+    void compile(const std::vector<Command>& commands);
+
+    // Recompile the [from, to] range for the lights of `groups` only. See Timeline::patch
+    void patch(int64_t from, int64_t to, const std::vector<int>& groups, const std::vector<Command>& commands);
 
     void reset();
 
-    const std::vector<Color>& getLightStates();
+    // Normalized RGBA of every light, ready to be uploaded to the renderer
+    const std::vector<glm::vec4>& getLightColors() const;
 
 private:
-    std::vector<AnimationDesc> lights;
-
-    std::vector<Color> light_states;
     std::vector<std::vector<size_t>> group_ids;
 
-    std::vector<Command> commands; // Must be ordered by trigger time. The last at [0], the first at [size-1]
+    // Copy on write: detach before any edit, copies may share it
+    Timeline& editTimeline();
+
+    std::shared_ptr<Timeline> timeline;
+    uint64_t timeline_version = 0;
+    std::vector<std::ptrdiff_t> active_segments; // Timeline segment currently played by each light
+
+    std::unique_ptr<LightStateEngine> light_states;
+    std::vector<glm::vec4> light_colors;
 };
 
 
@@ -0,0 +1,214 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "LightStateEngine.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+    constexpr uint8_t no_batch = 0xff;
+
+    // out[k] = from[k] + delta[k] * t[k]
+    void lerp_channel(const float* from, const float* delta, const float* t, float* out, std::size_t count) {
+        std::size_t k = 0;
+#if defined(__AVX2__)
+        for (; k + 8 <= count; k += 8) {
+            __m256 f = _mm256_loadu_ps(from + k);
+            __m256 d = _mm256_loadu_ps(delta + k);
+            __m256 x = _mm256_loadu_ps(t + k);
+            _mm256_storeu_ps(out + k, _mm256_fmadd_ps(d, x, f));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; k + 4 <= count; k += 4) {
+            float32x4_t f = vld1q_f32(from + k);
+            float32x4_t d = vld1q_f32(delta + k);
+            float32x4_t x = vld1q_f32(t + k);
+            vst1q_f32(out + k, vfmaq_f32(f, d, x));
+        }
+#endif
+        for (; k < count; ++k) {
+            out[k] = from[k] + delta[k] * t[k];
+        }
+    }
+
+    template<typename T>
+    void swap_remove(std::vector<T>& values, std::size_t index) {
+        values[index] = values.back();
+        values.pop_back();
+    }
+}
+
+void LightStateEngine::resize(size_t light_count) {
+    while (slots.size() > light_count) {
+        remove(slots.size() - 1);
+        slots.pop_back();
+    }
+
+    while (slots.size() < light_count) {
+        slots.push_back({no_batch, 0});
+        setAnimation(slots.size() - 1, AnimationDesc{});
+    }
+}
+
+size_t LightStateEngine::size() const {
+    return slots.size();
+}
+
+void LightStateEngine::setAnimation(size_t light, const AnimationDesc &animation) {
+    remove(light);
+
+    switch (animation.kind) {
+        case AnimationKind::toggle : {
+            auto& toggle = animation.toggle;
+            Color color = toggle.is_on ? toggle.color : Color{0, 0, 0, 255};
+            append(light, toggle_batch, 0, 0.0, 0, color, color);
+            break;
+        }
+
+        case AnimationKind::gradient : {
+            auto& gradient = animation.gradient;
+
+            BatchId batch_id = gradient_linear_batch;
+            switch (gradient.kind) {
+                case GradientKind::ease_in: batch_id = gradient_ease_in_batch; break;
+                case GradientKind::ease_out: batch_id = gradient_ease_out_batch; break;
+                case GradientKind::ease_in_out: batch_id = gradient_ease_in_out_batch; break;
+                default: break;
+            }
+
+            // A zero duration jumps straight to the end color
+            double rate = gradient.duration > 0 ? 1.0 / gradient.duration : std::numeric_limits<double>::max();
+            append(light, batch_id, gradient.start_sample, rate, 0, gradient.start_color, gradient.end_color);
+            break;
+        }
+
+        case AnimationKind::blink : {
+            auto& blink = animation.blink;
+            append(light, blink_batch, blink.start_sample, 0.0, blink.period, blink.on_color, blink.off_color);
+            break;
+        }
+    }
+}
+
+void LightStateEngine::evaluate(int64_t sample, glm::vec4 *out) {
+    for (uint8_t batch_id = 0; batch_id < batch_count; ++batch_id) {
+        auto& batch = batches[batch_id];
+        const size_t count = batch.size();
+        if (count == 0) continue;
+
+        // Toggles are constant, no need to interpolate
+        if (batch_id == toggle_batch) {
+            for (size_t k = 0; k < count; ++k) {
+                out[batch.lights[k]] = glm::vec4(batch.from[0][k], batch.from[1][k], batch.from[2][k], batch.from[3][k]);
+            }
+            continue;
+        }
+
+        computeT(BatchId(batch_id), batch, sample);
+
+        for (int c = 0; c < 4; ++c) {
+            batch.channels[c].resize(count);
+            lerp_channel(batch.from[c].data(), batch.delta[c].data(), batch.t.data(), batch.channels[c].data(), count);
+        }
+
+        for (size_t k = 0; k < count; ++k) {
+            out[batch.lights[k]] = glm::vec4(batch.channels[0][k], batch.channels[1][k], batch.channels[2][k], batch.channels[3][k]);
+        }
+    }
+}
+
+void LightStateEngine::append(uint32_t light, BatchId batch_id, int64_t start_sample, double rate, int64_t period, const Color &from, const Color &to) {
+    auto& batch = batches[batch_id];
+
+    slots[light] = {batch_id, uint32_t(batch.size())};
+
+    batch.lights.push_back(light);
+    batch.start_sample.push_back(start_sample);
+    batch.rate.push_back(rate);
+    batch.period.push_back(period);
+
+    const int from_channels[4] = {from.r, from.g, from.b, from.a};
+    const int to_channels[4] = {to.r, to.g, to.b, to.a};
+    for (int c = 0; c < 4; ++c) {
+        batch.from[c].push_back(from_channels[c] / 255.f);
+        batch.delta[c].push_back((to_channels[c] - from_channels[c]) / 255.f);
+    }
+}
+
+void LightStateEngine::remove(uint32_t light) {
+    auto slot = slots.at(light);
+    if (slot.batch == no_batch) return;
+
+    // Swap with the last light of the batch to keep the arrays contiguous
+    auto& batch = batches[slot.batch];
+    auto moved_light = batch.lights.back();
+
+    swap_remove(batch.lights, slot.index);
+    swap_remove(batch.start_sample, slot.index);
+    swap_remove(batch.rate, slot.index);
+    swap_remove(batch.period, slot.index);
+    for (int c = 0; c < 4; ++c) {
+        swap_remove(batch.from[c], slot.index);
+        swap_remove(batch.delta[c], slot.index);
+    }
+
+    if (moved_light != light) slots[moved_light].index = slot.index;
+    slots[light].batch = no_batch;
+}
+
+void LightStateEngine::computeT(BatchId batch_id, Batch &batch, int64_t sample) {
+    const size_t count = batch.size();
+    batch.t.resize(count);
+    float* t = batch.t.data();
+
+    if (batch_id == blink_batch) {
+        // On for the first half of the period (t = 0), off for the second one (t = 1)
+        for (size_t k = 0; k < count; ++k) {
+            const int64_t period = batch.period[k];
+            if (period == 0) {
+                t[k] = 1.f;
+                continue;
+            }
+            const int64_t elapsed = std::max(int64_t(0), sample - batch.start_sample[k]) % period;
+            t[k] = elapsed < period / 2 ? 0.f : 1.f;
+        }
+        return;
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        t[k] = float(std::clamp(double(sample - batch.start_sample[k]) * batch.rate[k], 0.0, 1.0));
+    }
+
+    // Same curves as InterpolationUtils, one easing per batch so the loops stay branch-free
+    switch (batch_id) {
+        case gradient_ease_in_batch:
+            for (size_t k = 0; k < count; ++k) t[k] = t[k] * t[k] * t[k];
+            break;
+
+        case gradient_ease_out_batch:
+            for (size_t k = 0; k < count; ++k) {
+                float u = 1.f - t[k];
+                t[k] = u * u * u;
+            }
+            break;
+
+        case gradient_ease_in_out_batch:
+            for (size_t k = 0; k < count; ++k) {
+                float in = 2.f * t[k];
+                float out = 2.f * (1.f - t[k]);
+                t[k] = t[k] < 0.5f ? 0.5f * in * in * in : 1.f - 0.5f * out * out * out;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,75 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef LIGHTSTATEENGINE_H
+#define LIGHTSTATEENGINE_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "LightManager.h"
+#include "../libs/glm/glm.hpp"
+
+// Structure-of-arrays evaluation of the light colors.
+// Lights are bucketed by what their animation computes (toggle, gradient per easing, blink), so each
+// bucket is a branch-free loop over contiguous float channels. Every animation boils down to
+// color = from + delta * t, only the way t is computed differs between buckets.
+class LightStateEngine {
+public:
+    // New lights get the default animation
+    void resize(size_t light_count);
+    size_t size() const;
+
+    // Move a light to the bucket of its new animation. O(1)
+    void setAnimation(size_t light, const AnimationDesc& animation);
+
+    // Write the normalized RGBA of every light to out[0 .. size())
+    void evaluate(int64_t sample, glm::vec4* out);
+
+private:
+    enum BatchId : uint8_t {
+        toggle_batch,
+        gradient_linear_batch,
+        gradient_ease_in_batch,
+        gradient_ease_out_batch,
+        gradient_ease_in_out_batch,
+        blink_batch,
+        batch_count
+    };
+
+    struct Batch {
+        std::vector<uint32_t> lights;
+
+        std::vector<int64_t> start_sample;
+        std::vector<double> rate;           // Gradient: 1 / duration
+        std::vector<int64_t> period;        // Blink
+
+        std::array<std::vector<float>, 4> from;
+        std::array<std::vector<float>, 4> delta;
+
+        // Scratch, reused across evaluations
+        std::vector<float> t;
+        std::array<std::vector<float>, 4> channels;
+
+        size_t size() const { return lights.size(); }
+    };
+
+    struct Slot {
+        uint8_t batch;
+        uint32_t index;
+    };
+
+    void append(uint32_t light, BatchId batch_id, int64_t start_sample, double rate, int64_t period, const Color& from, const Color& to);
+    void remove(uint32_t light);
+
+    static void computeT(BatchId batch_id, Batch& batch, int64_t sample);
+
+    std::array<Batch, batch_count> batches;
+    std::vector<Slot> slots;
+};
+
+
+
+#endif //LIGHTSTATEENGINE_H
@@ -0,0 +1,92 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string &path) {
+    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        file_handle = nullptr;
+        throw std::runtime_error("Unable to open " + path);
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        CloseHandle(file_handle);
+        throw std::runtime_error("Unable to read the size of " + path);
+    }
+    size = std::size_t(file_size.QuadPart);
+
+    // An empty file can't be mapped, it is just an empty span
+    if (size == 0) return;
+
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) {
+        CloseHandle(file_handle);
+        throw std::runtime_error("Unable to map " + path);
+    }
+
+    data = static_cast<const std::byte*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        throw std::runtime_error("Unable to map " + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+    file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) throw std::runtime_error("Unable to open " + path);
+
+    struct stat status{};
+    if (fstat(file_descriptor, &status) != 0) {
+        close(file_descriptor);
+        throw std::runtime_error("Unable to read the size of " + path);
+    }
+    size = std::size_t(status.st_size);
+
+    // An empty file can't be mapped, it is just an empty span
+    if (size == 0) return;
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close(file_descriptor);
+        throw std::runtime_error("Unable to map " + path);
+    }
+    data = static_cast<const std::byte*>(mapping);
+}
+
+MappedFile::~MappedFile() {
+    if (data) munmap(const_cast<std::byte*>(data), size);
+    if (file_descriptor >= 0) close(file_descriptor);
+}
+
+#endif
+
+std::span<const std::byte> MappedFile::bytes() const {
+    return {data, size};
+}
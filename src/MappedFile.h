@@ -0,0 +1,39 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+
+// Read-only memory mapping of a whole file. The bytes stay valid as long as the object lives.
+// Throw std::runtime_error if the file can't be opened or mapped
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const std::byte> bytes() const;
+
+private:
+    const std::byte* data = nullptr;
+    std::size_t size = 0;
+
+#if defined(_WIN32)
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int file_descriptor = -1;
+#endif
+};
+
+
+
+#endif //MAPPEDFILE_H
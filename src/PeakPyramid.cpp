@@ -0,0 +1,113 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "PeakPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+PeakBucket computePeakBucket(const float *samples, std::size_t count) {
+    if (count == 0) return {};
+
+    float min = samples[0];
+    float max = samples[0];
+    float sum_squares = 0.0f;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        min = std::min(min, samples[i]);
+        max = std::max(max, samples[i]);
+        sum_squares += samples[i] * samples[i];
+    }
+
+    return {min, max, std::sqrt(sum_squares / count)};
+}
+
+void PeakPyramid::build(std::span<const float> samples) {
+    clear();
+    extend(samples);
+}
+
+void PeakPyramid::extend(std::span<const float> samples) {
+    if (samples.size() <= sample_count) return;
+
+    // The last bucket of every level may have been partial, it is recomputed with the new samples
+    const std::size_t previous_count = sample_count;
+    sample_count = samples.size();
+
+    // Level 0 is built from the raw samples
+    const std::size_t base = bucket_sizes[0];
+    auto& first = levels[0];
+    std::size_t dirty = previous_count / base;
+    first.resize((sample_count + base - 1) / base);
+    for (std::size_t i = dirty; i < first.size(); ++i) {
+        std::size_t start = i * base;
+        first[i] = computePeakBucket(samples.data() + start, std::min(base, sample_count - start));
+    }
+
+    // Every other level merges the buckets of the level below
+    for (std::size_t l = 1; l < level_count; ++l) {
+        const auto& below = levels[l - 1];
+        const std::size_t ratio = bucket_sizes[l] / bucket_sizes[l - 1];
+        const std::size_t size = bucket_sizes[l];
+
+        auto& level = levels[l];
+        dirty = previous_count / size;
+        level.resize((sample_count + size - 1) / size);
+        for (std::size_t i = dirty; i < level.size(); ++i) {
+            std::size_t first_child = i * ratio;
+            std::size_t last_child = std::min(first_child + ratio, below.size());
+
+            PeakBucket bucket = below[first_child];
+            float sum_squares = 0.0f;
+            for (std::size_t c = first_child; c < last_child; ++c) {
+                bucket.min = std::min(bucket.min, below[c].min);
+                bucket.max = std::max(bucket.max, below[c].max);
+                sum_squares += below[c].rms * below[c].rms;
+            }
+            bucket.rms = std::sqrt(sum_squares / (last_child - first_child));
+            level[i] = bucket;
+        }
+    }
+}
+
+void PeakPyramid::clear() {
+    for (auto& level : levels) level.clear();
+    sample_count = 0;
+}
+
+bool PeakPyramid::empty() const {
+    return sample_count == 0;
+}
+
+std::size_t PeakPyramid::sampleCount() const {
+    return sample_count;
+}
+
+int PeakPyramid::pickLevel(float samples_per_pixel) const {
+    int level = -1;
+    for (std::size_t l = 0; l < level_count; ++l) {
+        if (bucket_sizes[l] <= samples_per_pixel) level = int(l);
+    }
+    return level;
+}
+
+PeakBucket PeakPyramid::query(int level, std::size_t start, std::size_t end) const {
+    const auto& buckets = levels.at(level);
+    if (buckets.empty() || start >= end) return {};
+
+    const std::size_t size = bucket_sizes[level];
+    std::size_t first = std::min(start / size, buckets.size() - 1);
+    std::size_t last = std::min((end - 1) / size, buckets.size() - 1);
+
+    PeakBucket result = buckets[first];
+    float sum_squares = 0.0f;
+    for (std::size_t i = first; i <= last; ++i) {
+        result.min = std::min(result.min, buckets[i].min);
+        result.max = std::max(result.max, buckets[i].max);
+        sum_squares += buckets[i].rms * buckets[i].rms;
+    }
+    result.rms = std::sqrt(sum_squares / (last - first + 1));
+
+    return result;
+}
@@ -0,0 +1,52 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef PEAKPYRAMID_H
+#define PEAKPYRAMID_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+struct PeakBucket {
+    float min = 0.0f;
+    float max = 0.0f;
+    float rms = 0.0f;
+};
+
+// Mipmap-style min/max/rms summary of a sample buffer, used to draw the waveform
+// at any zoom level while only touching O(canvas width) buckets per frame.
+class PeakPyramid {
+public:
+    static constexpr std::size_t level_count = 4;
+    static constexpr std::array<std::size_t, level_count> bucket_sizes = {64, 256, 1024, 4096};
+
+    void build(std::span<const float> samples);
+
+    // `samples` starts with the samples the pyramid was built from and may have grown since.
+    // Only the buckets touched by the new samples are computed
+    void extend(std::span<const float> samples);
+    void clear();
+
+    bool empty() const;
+    std::size_t sampleCount() const;
+
+    // Coarsest level whose bucket still fits into one pixel, -1 if raw samples should be read instead
+    int pickLevel(float samples_per_pixel) const;
+
+    // Combine every bucket of `level` overlapping the sample range [start, end)
+    PeakBucket query(int level, std::size_t start, std::size_t end) const;
+
+private:
+    std::array<std::vector<PeakBucket>, level_count> levels;
+    std::size_t sample_count = 0;
+};
+
+// Min/max/rms straight from the samples, for ranges narrower than the finest bucket
+PeakBucket computePeakBucket(const float* samples, std::size_t count);
+
+
+#endif //PEAKPYRAMID_H
@@ -0,0 +1,340 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "ProjectFile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "MappedFile.h"
+
+static_assert(std::endian::native == std::endian::little, "The binary project format is little-endian");
+
+namespace {
+    constexpr uint64_t section_alignment = 8;
+
+    uint64_t align(uint64_t offset) {
+        return (offset + section_alignment - 1) / section_alignment * section_alignment;
+    }
+
+    uint8_t toByte(int channel) {
+        return uint8_t(std::clamp(channel, 0, 255));
+    }
+
+    void writeColor(uint8_t out[4], const Color& color) {
+        out[0] = toByte(color.r);
+        out[1] = toByte(color.g);
+        out[2] = toByte(color.b);
+        out[3] = toByte(color.a);
+    }
+
+    Color readColor(const uint8_t in[4]) {
+        return Color{in[0], in[1], in[2], in[3]};
+    }
+
+    CommandRecord toRecord(const Command& command) {
+        CommandRecord record{};
+        record.trigger_sample = command.trigger_sample;
+        record.group_id = command.group_id;
+        record.kind = uint8_t(command.animation.kind);
+
+        const auto& animation = command.animation;
+        switch (animation.kind) {
+            case AnimationKind::toggle:
+                record.is_on = animation.toggle.is_on;
+                writeColor(record.colors[0], animation.toggle.color);
+                break;
+
+            case AnimationKind::gradient:
+                record.gradient_kind = uint8_t(animation.gradient.kind);
+                record.length = animation.gradient.duration;
+                writeColor(record.colors[0], animation.gradient.start_color);
+                writeColor(record.colors[1], animation.gradient.end_color);
+                break;
+
+            case AnimationKind::blink:
+                record.length = animation.blink.period;
+                writeColor(record.colors[0], animation.blink.on_color);
+                writeColor(record.colors[1], animation.blink.off_color);
+                break;
+        }
+
+        return record;
+    }
+
+    Command fromRecord(const CommandRecord& record) {
+        if (record.kind > uint8_t(AnimationKind::blink)) throw std::runtime_error("Invalid animation kind");
+        if (record.gradient_kind > uint8_t(GradientKind::ease_in_out)) throw std::runtime_error("Invalid gradient kind");
+
+        // Same defaults as the JSON loader for the animations that are not used
+        Command command{};
+        command.group_id = record.group_id;
+
+        auto& animation = command.animation;
+        animation.kind = AnimationKind(record.kind);
+        animation.toggle = ToggleInfo{false, Color{0, 0, 0, 255}};
+        animation.gradient = GradientInfo{Color{0, 0, 0, 255}, Color{0, 0, 0, 255}, GradientKind::linear, 0, 0};
+        animation.blink = BlinkInfo{Color{0, 0, 0, 255}, Color{0, 0, 0, 255}, 0, 0};
+
+        switch (animation.kind) {
+            case AnimationKind::toggle:
+                animation.toggle = ToggleInfo{record.is_on != 0, readColor(record.colors[0])};
+                break;
+
+            case AnimationKind::gradient:
+                animation.gradient.start_color = readColor(record.colors[0]);
+                animation.gradient.end_color = readColor(record.colors[1]);
+                animation.gradient.kind = GradientKind(record.gradient_kind);
+                animation.gradient.duration = (unsigned int)record.length;
+                break;
+
+            case AnimationKind::blink:
+                animation.blink.on_color = readColor(record.colors[0]);
+                animation.blink.off_color = readColor(record.colors[1]);
+                animation.blink.period = record.length;
+                break;
+        }
+
+        // The start samples are given by the trigger sample, as in the JSON format
+        retimeCommand(command, record.trigger_sample);
+        return command;
+    }
+
+    template<typename T>
+    void writeSection(std::ofstream& file, const SectionEntry& entry, const std::vector<T>& records) {
+        // Zero padding up to the aligned offset
+        static const char zeros[section_alignment] = {};
+        file.write(zeros, std::streamsize(entry.offset - uint64_t(file.tellp())));
+        file.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(T)));
+    }
+}
+
+ProjectView::ProjectView(std::span<const std::byte> bytes) : bytes(bytes) {
+    if (bytes.size() < sizeof(ProjectFileHeader)) throw std::runtime_error("Truncated project file");
+
+    file_header = reinterpret_cast<const ProjectFileHeader*>(bytes.data());
+    if (std::memcmp(file_header->magic, project_file_magic, sizeof(project_file_magic)) != 0) {
+        throw std::runtime_error("Not a binary ELISE project");
+    }
+    if (file_header->version == 0 || file_header->version > project_file_version) {
+        throw std::runtime_error("Unsupported project version: " + std::to_string(file_header->version));
+    }
+    if (file_header->header_size < sizeof(ProjectFileHeader) || file_header->section_count < project_section_count) {
+        throw std::runtime_error("Invalid project header");
+    }
+    if (file_header->file_size != bytes.size()) throw std::runtime_error("Truncated project file");
+
+    // Touch every section once so the accessors can't fail on bounds
+    fixtures();
+    groups();
+    section<uint32_t>(group_lights_section);
+    keyframes();
+    commands();
+    section<char>(strings_section);
+}
+
+const ProjectFileHeader & ProjectView::header() const {
+    return *file_header;
+}
+
+template<typename T>
+std::span<const T> ProjectView::section(ProjectSection section) const {
+    const auto& entry = file_header->sections[section];
+
+    if (entry.offset % alignof(T) != 0 || entry.offset > bytes.size()
+        || entry.count > (bytes.size() - entry.offset) / sizeof(T)) {
+        throw std::runtime_error("Invalid project section");
+    }
+
+    return {reinterpret_cast<const T*>(bytes.data() + entry.offset), std::size_t(entry.count)};
+}
+
+std::span<const FixtureRecord> ProjectView::fixtures() const {
+    return section<FixtureRecord>(fixtures_section);
+}
+
+std::span<const GroupRecord> ProjectView::groups() const {
+    return section<GroupRecord>(groups_section);
+}
+
+std::span<const KeyframeRecord> ProjectView::keyframes() const {
+    return section<KeyframeRecord>(keyframes_section);
+}
+
+std::span<const CommandRecord> ProjectView::commands() const {
+    return section<CommandRecord>(commands_section);
+}
+
+std::string_view ProjectView::groupName(const GroupRecord &group) const {
+    auto strings = section<char>(strings_section);
+    if (uint64_t(group.name_offset) + group.name_length > strings.size()) throw std::runtime_error("Invalid group name");
+    return {strings.data() + group.name_offset, group.name_length};
+}
+
+std::span<const uint32_t> ProjectView::groupLights(const GroupRecord &group) const {
+    auto lights = section<uint32_t>(group_lights_section);
+    if (uint64_t(group.first_light) + group.light_count > lights.size()) throw std::runtime_error("Invalid group lights");
+    return lights.subspan(group.first_light, group.light_count);
+}
+
+std::span<const CommandRecord> ProjectView::keyframeCommands(const KeyframeRecord &keyframe) const {
+    auto all = commands();
+    if (uint64_t(keyframe.first_command) + keyframe.command_count > all.size()) throw std::runtime_error("Invalid keyframe commands");
+    return all.subspan(keyframe.first_command, keyframe.command_count);
+}
+
+ProjectData toProjectData(const ProjectView &view) {
+    const auto& header = view.header();
+
+    ProjectData p;
+    p.light_count = header.light_count;
+    p.sample_rate = header.sample_rate;
+    p.max_uuid = header.max_uuid;
+
+    auto fixtures = view.fixtures();
+    if (fixtures.size() != p.light_count) {
+        throw std::runtime_error("Fixture count doesn't match the light count");
+    }
+    p.fixtures.resize(fixtures.size());
+    for (std::size_t i = 0; i < fixtures.size(); ++i) {
+        p.fixtures[i] = Fixture{{fixtures[i].x, fixtures[i].y}, {fixtures[i].width, fixtures[i].height}};
+    }
+
+    p.groups.reserve(view.groups().size());
+    for (auto& record : view.groups()) {
+        Group group;
+        group.name = std::string(view.groupName(record));
+
+        auto lights = view.groupLights(record);
+        group.lights.assign(lights.begin(), lights.end());
+        for (size_t light : group.lights) {
+            if (light >= p.light_count) throw std::runtime_error("Invalid light in group: " + group.name);
+        }
+
+        p.groups.push_back(std::move(group));
+    }
+
+    // Same uuids as the JSON loader: the keyframe index
+    auto keyframes = view.keyframes();
+    p.keyframes.reserve(keyframes.size());
+    p.keyframe_uuid_to_commands.reserve(keyframes.size());
+
+    int64_t uuid = 0;
+    for (auto& record : keyframes) {
+        Keyframe keyframe;
+        keyframe.is_locked = true;
+        keyframe.is_enabled = true;
+        keyframe.trigger_sample = record.trigger_sample;
+        keyframe.uuid = uuid++;
+        p.keyframes.push_back(keyframe);
+
+        auto& commands = p.keyframe_uuid_to_commands[keyframe.uuid];
+        auto command_records = view.keyframeCommands(record);
+        commands.reserve(command_records.size());
+        for (auto& command : command_records) commands.push_back(fromRecord(command));
+    }
+
+    return p;
+}
+
+bool isBinaryProject(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+
+    char magic[sizeof(project_file_magic)] = {};
+    file.read(magic, sizeof(magic));
+
+    return file.gcount() == sizeof(magic) && std::memcmp(magic, project_file_magic, sizeof(magic)) == 0;
+}
+
+ProjectData loadBinaryProject(const std::string &path) {
+    MappedFile file(path);
+    return toProjectData(ProjectView(file.bytes()));
+}
+
+void saveBinaryProject(const std::string &path, const ProjectData &data) {
+    std::vector<FixtureRecord> fixtures;
+    fixtures.reserve(data.fixtures.size());
+    for (auto& fixture : data.fixtures) {
+        fixtures.push_back({fixture.position.x, fixture.position.y, fixture.size.x, fixture.size.y});
+    }
+
+    std::vector<GroupRecord> groups;
+    std::vector<uint32_t> group_lights;
+    std::vector<char> strings;
+    for (auto& group : data.groups) {
+        groups.push_back({uint32_t(strings.size()), uint32_t(group.name.size()), uint32_t(group_lights.size()), uint32_t(group.lights.size())});
+        strings.insert(strings.end(), group.name.begin(), group.name.end());
+        for (size_t light : group.lights) group_lights.push_back(uint32_t(light));
+    }
+
+    // Keyframes in time order, each one followed by its own commands
+    std::vector<const Keyframe*> ordered;
+    ordered.reserve(data.keyframes.size());
+    for (auto& keyframe : data.keyframes) ordered.push_back(&keyframe);
+    std::stable_sort(ordered.begin(), ordered.end(), [](const Keyframe* a, const Keyframe* b) { return compare(*a, *b); });
+
+    std::vector<KeyframeRecord> keyframes;
+    std::vector<CommandRecord> commands;
+    keyframes.reserve(ordered.size());
+    for (auto* keyframe : ordered) {
+        KeyframeRecord record{keyframe->trigger_sample, uint32_t(commands.size()), 0};
+
+        auto found = data.keyframe_uuid_to_commands.find(keyframe->uuid);
+        if (found != data.keyframe_uuid_to_commands.end()) {
+            for (auto& command : found->second) commands.push_back(toRecord(command));
+            record.command_count = uint32_t(found->second.size());
+        }
+
+        keyframes.push_back(record);
+    }
+
+    if (commands.size() > std::numeric_limits<uint32_t>::max() || strings.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Project too large for the binary format");
+    }
+
+    ProjectFileHeader header{};
+    std::memcpy(header.magic, project_file_magic, sizeof(project_file_magic));
+    header.version = project_file_version;
+    header.header_size = sizeof(ProjectFileHeader);
+    header.light_count = data.light_count;
+    header.max_uuid = data.max_uuid;
+    header.sample_rate = data.sample_rate;
+    header.section_count = project_section_count;
+
+    uint64_t offset = sizeof(ProjectFileHeader);
+    auto place = [&](ProjectSection section, uint64_t count, uint64_t record_size) {
+        offset = align(offset);
+        header.sections[section] = {offset, count};
+        offset += count * record_size;
+    };
+    place(fixtures_section, fixtures.size(), sizeof(FixtureRecord));
+    place(groups_section, groups.size(), sizeof(GroupRecord));
+    place(group_lights_section, group_lights.size(), sizeof(uint32_t));
+    place(keyframes_section, keyframes.size(), sizeof(KeyframeRecord));
+    place(commands_section, commands.size(), sizeof(CommandRecord));
+    place(strings_section, strings.size(), sizeof(char));
+    header.file_size = offset;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) throw std::runtime_error("Failed to open file " + path);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeSection(file, header.sections[fixtures_section], fixtures);
+    writeSection(file, header.sections[groups_section], groups);
+    writeSection(file, header.sections[group_lights_section], group_lights);
+    writeSection(file, header.sections[keyframes_section], keyframes);
+    writeSection(file, header.sections[commands_section], commands);
+    writeSection(file, header.sections[strings_section], strings);
+
+    if (!file) throw std::runtime_error("Failed to write file " + path);
+}
+
+ProjectData loadProject(const std::string &path) {
+    if (isBinaryProject(path)) return loadBinaryProject(path);
+    return loadJson(path);
+}
@@ -0,0 +1,127 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "JsonHandler.h"
+
+// Binary .elise container. Every section is an array of fixed-size records, so a mapped file is read in place:
+//
+//   ProjectFileHeader | fixtures | groups | group lights | keyframes | commands | strings
+//
+// Sections are 8-byte aligned and located by the offsets of the header. Keyframes are sorted by trigger sample
+// and own a contiguous run of commands. Group names live in the string table. Values are little-endian.
+// JSON (JsonHandler) stays the interchange format, loadProject() opens both.
+
+inline constexpr char project_file_magic[8] = {'E', 'L', 'I', 'S', 'E', 'B', 'I', 'N'};
+inline constexpr uint32_t project_file_version = 1;
+
+enum ProjectSection : uint32_t {
+    fixtures_section,
+    groups_section,
+    group_lights_section,
+    keyframes_section,
+    commands_section,
+    strings_section,
+    project_section_count
+};
+
+struct SectionEntry {
+    uint64_t offset;    // From the start of the file
+    uint64_t count;     // Records, bytes for the string table
+};
+
+struct ProjectFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+
+    uint64_t light_count;
+    int64_t max_uuid;
+    int32_t sample_rate;
+    uint32_t section_count;
+
+    SectionEntry sections[project_section_count];
+};
+
+struct FixtureRecord {
+    float x, y;
+    float width, height;
+};
+
+struct GroupRecord {
+    uint32_t name_offset;   // In the string table
+    uint32_t name_length;
+    uint32_t first_light;   // In the group lights section
+    uint32_t light_count;
+};
+
+struct KeyframeRecord {
+    int64_t trigger_sample;
+    uint32_t first_command;
+    uint32_t command_count;
+};
+
+struct CommandRecord {
+    int64_t trigger_sample;
+    int64_t length;         // Gradient duration or blink period, in samples
+    int32_t group_id;
+    uint8_t kind;           // AnimationKind
+    uint8_t gradient_kind;  // GradientKind
+    uint8_t is_on;          // Toggle
+    uint8_t padding;
+    uint8_t colors[2][4];   // RGBA. Toggle: color. Gradient: start, end. Blink: on, off
+};
+
+static_assert(sizeof(ProjectFileHeader) == 144);
+static_assert(sizeof(FixtureRecord) == 16);
+static_assert(sizeof(GroupRecord) == 16);
+static_assert(sizeof(KeyframeRecord) == 16);
+static_assert(sizeof(CommandRecord) == 32);
+
+// Typed access to the bytes of a binary project, without copying or converting anything.
+// The constructor checks the header and that every section fits in the buffer, the accessors check the
+// ranges they follow. Throw std::runtime_error on a malformed file
+class ProjectView {
+public:
+    explicit ProjectView(std::span<const std::byte> bytes);
+
+    const ProjectFileHeader& header() const;
+
+    std::span<const FixtureRecord> fixtures() const;
+    std::span<const GroupRecord> groups() const;
+    std::span<const KeyframeRecord> keyframes() const;
+    std::span<const CommandRecord> commands() const;
+
+    std::string_view groupName(const GroupRecord& group) const;
+    std::span<const uint32_t> groupLights(const GroupRecord& group) const;
+    std::span<const CommandRecord> keyframeCommands(const KeyframeRecord& keyframe) const;
+
+private:
+    template<typename T>
+    std::span<const T> section(ProjectSection section) const;
+
+    std::span<const std::byte> bytes;
+    const ProjectFileHeader* file_header;
+};
+
+ProjectData toProjectData(const ProjectView& view);
+
+bool isBinaryProject(const std::string& path);
+ProjectData loadBinaryProject(const std::string& path);
+
+// Throw std::runtime_error if the file can't be written
+void saveBinaryProject(const std::string& path, const ProjectData& data);
+
+// Binary or JSON, told apart by the magic. Throw std::runtime_error if the project can't be read
+ProjectData loadProject(const std::string& path);
+
+#endif //PROJECTFILE_H
@@ -0,0 +1,137 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "ProjectSaver.h"
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+#include "ProjectFile.h"
+
+ProjectData ProjectSnapshot::toProjectData() const {
+    ProjectData data;
+    data.keyframes = keyframes;
+    data.groups = groups;
+    data.light_count = light_count;
+    data.fixtures = fixtures;
+    data.sample_rate = sample_rate;
+    data.max_uuid = max_uuid;
+    data.keyframe_uuid_to_commands = commands.toMap();
+    return data;
+}
+
+ProjectSaver::ProjectSaver() : worker([this]() { run(); }) {}
+
+ProjectSaver::~ProjectSaver() {
+    {
+        std::lock_guard lock(mutex);
+        is_stopping = true;
+    }
+    has_job.notify_one();
+    worker.join();
+}
+
+void ProjectSaver::save(ProjectSnapshot snapshot, const std::string &path) {
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back({std::move(snapshot), path, false});
+    }
+    has_job.notify_one();
+}
+
+void ProjectSaver::autosave(ProjectSnapshot snapshot, const std::string &project_path) {
+    {
+        std::lock_guard lock(mutex);
+        auto pending = std::find_if(jobs.begin(), jobs.end(), [](const Job& job) { return job.is_autosave; });
+        if (pending != jobs.end()) *pending = {std::move(snapshot), project_path, true};
+        else jobs.push_back({std::move(snapshot), project_path, true});
+    }
+    has_job.notify_one();
+}
+
+std::vector<ProjectSaver::Result> ProjectSaver::takeResults() {
+    std::lock_guard lock(mutex);
+    return std::exchange(results, {});
+}
+
+std::filesystem::path ProjectSaver::getAutosavePath(const std::string &project_path, int slot) {
+    std::filesystem::path directory;
+    std::string name;
+    if (project_path.empty()) {
+        directory = std::filesystem::temp_directory_path() / "ELISE";
+        name = "untitled";
+    } else {
+        std::filesystem::path path(project_path);
+        directory = path.parent_path();
+        name = path.stem().string();
+    }
+    return directory / (name + ".autosave-" + std::to_string(slot) + ".elise");
+}
+
+void ProjectSaver::run() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(mutex);
+            has_job.wait(lock, [this]() { return is_stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        Result result;
+        result.is_autosave = job.is_autosave;
+        try {
+            std::filesystem::path path = job.is_autosave ? chooseAutosavePath(job.path) : std::filesystem::path(job.path);
+            result.path = path.string();
+
+            writeAtomically(path, job.snapshot.toProjectData());
+            result.is_success = true;
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+
+        std::lock_guard lock(mutex);
+        results.push_back(std::move(result));
+    }
+}
+
+void ProjectSaver::writeAtomically(const std::filesystem::path &path, const ProjectData &data) {
+    auto temp_path = path;
+    temp_path += ".tmp";
+
+    try {
+        saveBinaryProject(temp_path.string(), data);
+        std::filesystem::rename(temp_path, path);
+    } catch (...) {
+        std::error_code ignored;
+        std::filesystem::remove(temp_path, ignored);
+        throw;
+    }
+}
+
+std::filesystem::path ProjectSaver::chooseAutosavePath(const std::string &project_path) {
+    std::filesystem::path oldest_path;
+    std::filesystem::file_time_type oldest_time = std::filesystem::file_time_type::max();
+
+    for (int slot = 0; slot < autosave_slots; ++slot) {
+        auto path = getAutosavePath(project_path, slot);
+
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(path, error);
+        if (error) {
+            if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+            return path;
+        }
+
+        if (time < oldest_time) {
+            oldest_time = time;
+            oldest_path = path;
+        }
+    }
+
+    return oldest_path;
+}
@@ -0,0 +1,88 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef PROJECTSAVER_H
+#define PROJECTSAVER_H
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CommandStore.h"
+#include "JsonHandler.h"
+
+// Everything a project file stores, frozen at one point of the edition.
+// Taking one is cheap: the commands, by far the largest part, stay shared with the editor's CommandStore.
+struct ProjectSnapshot {
+    std::vector<Keyframe> keyframes;
+    std::vector<Group> groups;
+    size_t light_count = 0;
+    std::vector<Fixture> fixtures;
+    int sample_rate = 0;
+    int64_t max_uuid = 0;
+    CommandStore commands;
+
+    ProjectData toProjectData() const;
+};
+
+// Writes project snapshots on a worker thread so the UI never waits for the disk.
+// Every file is written next to its destination then renamed over it, a crash mid-save leaves the previous
+// version intact. Autosaves rotate through a ring of files beside the project.
+class ProjectSaver {
+public:
+    static constexpr int autosave_slots = 5;
+
+    struct Result {
+        std::string path;
+        bool is_autosave = false;
+        bool is_success = false;
+        std::string error;
+    };
+
+    ProjectSaver();
+    // Write what is still queued, then join the worker
+    ~ProjectSaver();
+
+    ProjectSaver(const ProjectSaver&) = delete;
+    ProjectSaver& operator=(const ProjectSaver&) = delete;
+
+    void save(ProjectSnapshot snapshot, const std::string& path);
+    // Write into the autosave ring of `project_path`, an empty path for untitled projects.
+    // Replaces an autosave still waiting in the queue, only the latest state matters
+    void autosave(ProjectSnapshot snapshot, const std::string& project_path);
+
+    // Saves finished since the last call
+    std::vector<Result> takeResults();
+
+    static std::filesystem::path getAutosavePath(const std::string& project_path, int slot);
+
+private:
+    struct Job {
+        ProjectSnapshot snapshot;
+        std::string path;
+        bool is_autosave = false;
+    };
+
+    void run();
+
+    static void writeAtomically(const std::filesystem::path& path, const ProjectData& data);
+    // A free slot, or the one holding the oldest autosave
+    static std::filesystem::path chooseAutosavePath(const std::string& project_path);
+
+    std::deque<Job> jobs;
+    std::vector<Result> results;
+    bool is_stopping = false;
+
+    std::mutex mutex;
+    std::condition_variable has_job;
+    std::thread worker;
+};
+
+
+
+#endif //PROJECTSAVER_H
@@ -0,0 +1,48 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "SampleStore.h"
+
+#include <algorithm>
+
+SampleStore::SampleStore(std::size_t capacity, int sample_rate)
+    : data(std::make_unique_for_overwrite<float[]>(capacity)), sample_capacity(capacity), sample_rate(sample_rate) {}
+
+std::span<const float> SampleStore::samples() const {
+    return {data.get(), available.load(std::memory_order_acquire)};
+}
+
+std::size_t SampleStore::size() const {
+    return available.load(std::memory_order_acquire);
+}
+
+std::size_t SampleStore::capacity() const {
+    return sample_capacity;
+}
+
+int SampleStore::getSampleRate() const {
+    return sample_rate;
+}
+
+bool SampleStore::isComplete() const {
+    return complete.load(std::memory_order_acquire);
+}
+
+float * SampleStore::writePointer() {
+    return data.get() + available.load(std::memory_order_relaxed);
+}
+
+std::size_t SampleStore::remaining() const {
+    return sample_capacity - available.load(std::memory_order_relaxed);
+}
+
+void SampleStore::commit(std::size_t count) {
+    // Release: the samples written before are visible to whoever sees the new size
+    auto size = available.load(std::memory_order_relaxed);
+    available.store(size + std::min(count, sample_capacity - size), std::memory_order_release);
+}
+
+void SampleStore::finish() {
+    complete.store(true, std::memory_order_release);
+}
@@ -0,0 +1,51 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef SAMPLESTORE_H
+#define SAMPLESTORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <span>
+
+
+// Song samples, written once by a decoder thread and read by everyone else without copies.
+// The buffer is allocated up front and never moves. The writer fills it from the front and publishes
+// how far it got, readers only ever see that immutable prefix.
+class SampleStore {
+public:
+    SampleStore(std::size_t capacity, int sample_rate);
+
+    SampleStore(const SampleStore&) = delete;
+    SampleStore& operator=(const SampleStore&) = delete;
+
+    // Published prefix, safe from any thread
+    std::span<const float> samples() const;
+    std::size_t size() const;
+
+    std::size_t capacity() const;
+    int getSampleRate() const;
+
+    // True once the writer is done, size() won't change anymore
+    bool isComplete() const;
+
+    // Writer side, single thread. Write at most remaining() samples at writePointer(), then commit them
+    float* writePointer();
+    std::size_t remaining() const;
+    void commit(std::size_t count);
+    void finish();
+
+private:
+    std::unique_ptr<float[]> data;
+    const std::size_t sample_capacity;
+    const int sample_rate;
+
+    std::atomic<std::size_t> available{0};
+    std::atomic<bool> complete{false};
+};
+
+
+
+#endif //SAMPLESTORE_H
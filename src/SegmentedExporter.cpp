@@ -0,0 +1,152 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "SegmentedExporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+
+SegmentedExporter::SegmentedExporter(const std::string &path,
+                                     const LightManager &light_manager,
+                                     Odin::Renderer &renderer,
+                                     std::span<const float> samples,
+                                     int sample_rate,
+                                     const ExportSettings &settings,
+                                     int64_t end_sample,
+                                     const SegmentedExportOptions &options)
+    : path(path),
+      renderer(renderer),
+      samples(samples),
+      sample_rate(sample_rate),
+      settings(settings),
+      options(options) {
+
+    validateExportSettings(settings);
+
+    frame_count = int(end_sample * settings.framerate / sample_rate);
+    segment_count = std::clamp(options.segment_count, 1, std::max(1, frame_count));
+
+    // A typo would otherwise silently leave the requested segment out of the export
+    for (int segment : options.only_segments) {
+        if (segment < 0 || segment >= segment_count)
+            throw std::runtime_error("Invalid segment index " + std::to_string(segment) + ", expected 0 to " + std::to_string(segment_count - 1));
+    }
+
+    // Each segment starts on a keyframe, and without B-frames the timestamps stay monotonic once concatenated
+    this->settings.max_b_frames = 0;
+    // Share the cores between the segment encoders instead of oversubscribing them
+    if (this->settings.thread_count == 0)
+        this->settings.thread_count = std::max(1, int(std::thread::hardware_concurrency()) / segment_count);
+
+    auto is_rendered = [&](int segment) {
+        return options.only_segments.empty()
+            || std::find(options.only_segments.begin(), options.only_segments.end(), segment) != options.only_segments.end();
+    };
+
+    for (int segment = 0; segment < segment_count; ++segment) {
+        auto segment_path = getSegmentPath(path, segment);
+
+        if (!is_rendered(segment)) {
+            if (!std::filesystem::exists(segment_path))
+                throw std::runtime_error("Missing segment to reuse: " + segment_path);
+            light_managers.push_back(nullptr);
+            segments.push_back(nullptr);
+            continue;
+        }
+
+        int first_frame = int(int64_t(frame_count) * segment / segment_count);
+        int end_frame = int(int64_t(frame_count) * (segment + 1) / segment_count);
+
+        light_managers.push_back(std::make_unique<LightManager>(light_manager));
+        segments.push_back(std::make_unique<VideoExporter>(segment_path, *light_managers.back(), renderer,
+                                                           std::span<const float>(), sample_rate, this->settings,
+                                                           end_sample, first_frame, end_frame));
+    }
+}
+
+SegmentedExporter::~SegmentedExporter() {
+    // Stop the segment pipelines before the light managers they evaluate
+    segments.clear();
+    light_managers.clear();
+}
+
+bool SegmentedExporter::exportFrame() {
+    if (is_concatenated) return false;
+
+    bool is_rendering = false;
+    for (auto& segment : segments) {
+        if (segment && segment->exportFrame()) is_rendering = true;
+    }
+    if (is_rendering) return true;
+
+    concatenate();
+    return false;
+}
+
+bool SegmentedExporter::exportFor(double seconds) {
+    using clock = std::chrono::steady_clock;
+    auto deadline = clock::now() + std::chrono::duration<double>(seconds);
+
+    // Always make some progress, even with a budget shorter than a frame
+    do {
+        if (!exportFrame()) return true;
+    } while (clock::now() < deadline);
+
+    return isDone();
+}
+
+void SegmentedExporter::exportAll() {
+    while (exportFrame()) {}
+}
+
+bool SegmentedExporter::isDone() const {
+    return is_concatenated;
+}
+
+float SegmentedExporter::getProgress() const {
+    int rendered = 0;
+    int to_render = 0;
+    for (auto& segment : segments) {
+        if (!segment) continue;
+        rendered += segment->getCurrentFrame();
+        to_render += segment->getFrameCount();
+    }
+
+    if (is_concatenated || to_render == 0) return 1.f;
+    return float(rendered) / float(to_render);
+}
+
+std::string SegmentedExporter::getSegmentPath(const std::string &path, int segment) {
+    std::string index = std::to_string(segment);
+    index.insert(0, std::max(0, 3 - int(index.size())), '0');
+
+    // Segments keep the container of the final file
+    auto extension = std::filesystem::path(path).extension().string();
+    return path + ".segment" + index + extension;
+}
+
+void SegmentedExporter::concatenate() {
+    // Finalize every segment before reading them back
+    segments.clear();
+    light_managers.clear();
+
+    // The header comes from the segments themselves, not from a fresh encoder that may not match them
+    MP4Encoder output(path, getSegmentPath(path, 0), settings, sample_rate, samples.empty() ? 0 : 1);
+    output.setAudio(samples);
+    for (int segment = 0; segment < segment_count; ++segment) {
+        output.appendVideoFile(getSegmentPath(path, segment));
+    }
+    output.finalize();
+
+    if (!options.keep_segments) {
+        for (int segment = 0; segment < segment_count; ++segment) {
+            std::filesystem::remove(getSegmentPath(path, segment));
+        }
+    }
+
+    is_concatenated = true;
+}
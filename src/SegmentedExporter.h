@@ -0,0 +1,74 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef SEGMENTEDEXPORTER_H
+#define SEGMENTEDEXPORTER_H
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "ExportSettings.h"
+#include "LightManager.h"
+#include "VideoExporter.h"
+#include "2D renderer/Renderer.h"
+
+struct SegmentedExportOptions {
+    int segment_count = 4;
+    bool keep_segments = false;         // Keep the segment files, to re-export only some of them later
+    std::vector<int> only_segments;     // Render only these segments and reuse the others from disk. Empty renders all
+};
+
+// Splits the show into frame ranges encoded as independent video-only segments, then stream-copies them into
+// the final file with the soundtrack. Each segment evaluates its own copy of the show and owns its encoder
+// pipeline, so long shows keep every core busy; the GL thread renders the segments in turn.
+class SegmentedExporter {
+public:
+    // Same requirements as VideoExporter. The light manager is only copied, it can be used again right away
+    SegmentedExporter(const std::string& path,
+                      const LightManager& light_manager,
+                      Odin::Renderer& renderer,
+                      std::span<const float> samples,
+                      int sample_rate,
+                      const ExportSettings& settings,
+                      int64_t end_sample,
+                      const SegmentedExportOptions& options);
+    ~SegmentedExporter();
+
+    // Render one frame of every unfinished segment, concatenate once they are all done.
+    // Return false once the final file is written
+    bool exportFrame();
+
+    // Export frames until done or `seconds` have elapsed. Return true once done
+    bool exportFor(double seconds);
+
+    void exportAll();
+
+    bool isDone() const;
+    float getProgress() const;
+
+    static std::string getSegmentPath(const std::string& path, int segment);
+
+private:
+    void concatenate();
+
+    std::string path;
+    Odin::Renderer& renderer;
+    std::span<const float> samples;
+    int sample_rate;
+    ExportSettings settings;
+    SegmentedExportOptions options;
+
+    int segment_count;
+    std::vector<std::unique_ptr<LightManager>> light_managers;
+    std::vector<std::unique_ptr<VideoExporter>> segments;   // Null for the segments reused from disk
+
+    int frame_count = 0;
+    bool is_concatenated = false;
+};
+
+
+
+#endif //SEGMENTEDEXPORTER_H
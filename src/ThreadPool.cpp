@@ -0,0 +1,137 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+ThreadPool::ThreadPool(unsigned thread_count) {
+    thread_count = std::max(1u, thread_count);
+    workers.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool & ThreadPool::global() {
+    static ThreadPool pool;
+    return pool;
+}
+
+unsigned ThreadPool::size() const {
+    return workers.size();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::parallel_for(std::size_t count, std::size_t min_chunk, const std::function<void(std::size_t, std::size_t)> &func) {
+    if (count == 0) return;
+
+    std::size_t chunk_count = std::min<std::size_t>(size() + 1, std::max<std::size_t>(1, count / std::max<std::size_t>(1, min_chunk)));
+    if (chunk_count <= 1) {
+        func(0, count);
+        return;
+    }
+
+    std::size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+    // The count is only touched under the mutex: the last worker notifies while holding it, so once the
+    // caller reads zero no worker can still be using the latch and it is safe to leave the stack frame.
+    // The first exception thrown by a chunk is kept and rethrown on the caller once every chunk is done
+    struct Latch {
+        std::size_t remaining;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    } latch;
+    latch.remaining = chunk_count - 1;
+
+    auto run_chunk = [&latch, &func](std::size_t begin, std::size_t end) {
+        if (begin >= end) return;
+        try {
+            func(begin, end);
+        } catch (...) {
+            std::lock_guard lock(latch.mutex);
+            if (!latch.error) latch.error = std::current_exception();
+        }
+    };
+
+    for (std::size_t c = 1; c < chunk_count; ++c) {
+        std::size_t begin = std::min(count, c * chunk_size);
+        std::size_t end = std::min(count, begin + chunk_size);
+
+        submit([&latch, run_chunk, begin, end]() {
+            run_chunk(begin, end);
+
+            std::lock_guard lock(latch.mutex);
+            if (--latch.remaining == 0) latch.done.notify_all();
+        });
+    }
+
+    // The first chunk runs on the calling thread
+    run_chunk(0, std::min(count, chunk_size));
+
+    // Help with queued work instead of sleeping, so nested calls from a worker can't starve the pool
+    while (true) {
+        {
+            std::unique_lock lock(latch.mutex);
+            if (latch.remaining == 0) break;
+        }
+
+        if (!runPendingTask()) {
+            std::unique_lock lock(latch.mutex);
+            if (latch.done.wait_for(lock, std::chrono::milliseconds(1), [&latch]() { return latch.remaining == 0; })) break;
+        }
+    }
+
+    if (latch.error) std::rethrow_exception(latch.error);
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+bool ThreadPool::runPendingTask() {
+    std::function<void()> task;
+    {
+        std::lock_guard lock(mutex);
+        if (tasks.empty()) return false;
+
+        task = std::move(tasks.front());
+        tasks.pop_front();
+    }
+    task();
+    return true;
+}
@@ -0,0 +1,50 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Fixed set of worker threads shared by the audio analysis and export code.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned thread_count = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process wide pool, sized to the hardware
+    static ThreadPool& global();
+
+    unsigned size() const;
+
+    void submit(std::function<void()> task);
+
+    // Split [0, count) into contiguous ranges of at least `min_chunk` elements and run func(begin, end)
+    // on each of them. Blocks until every range is done; the calling thread helps while waiting.
+    // If func throws, the first exception is rethrown here once every range has finished.
+    void parallel_for(std::size_t count, std::size_t min_chunk, const std::function<void(std::size_t, std::size_t)>& func);
+
+private:
+    void workerLoop();
+    bool runPendingTask();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+
+
+#endif //THREADPOOL_H
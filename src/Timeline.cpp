@@ -0,0 +1,112 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "Timeline.h"
+
+#include <algorithm>
+
+namespace {
+    const AnimationDesc default_animation{};
+}
+
+void Timeline::compile(const std::vector<Command> &commands, const std::vector<std::vector<size_t>> &group_ids, size_t light_count) {
+    tracks.assign(light_count, {});
+    version++;
+
+    for (auto& command : commands) {
+        for (size_t light_id : group_ids.at(command.group_id)) {
+            auto& track = tracks.at(light_id);
+
+            // A later command on the same sample overrides the previous one
+            if (!track.empty() && track.back().start_sample == command.trigger_sample) {
+                track.back().animation = command.animation;
+            } else {
+                track.push_back({command.trigger_sample, command.animation});
+            }
+        }
+    }
+}
+
+void Timeline::patch(int64_t from, int64_t to, const std::vector<size_t> &lights, const std::vector<Command> &commands, const std::vector<std::vector<size_t>> &group_ids) {
+    version++;
+
+    std::vector<bool> is_patched(tracks.size(), false);
+    for (size_t light_id : lights) is_patched.at(light_id) = true;
+
+    // Same rules as compile(), restricted to the patched lights
+    std::vector<std::vector<TimelineSegment>> patches(tracks.size());
+    for (auto& command : commands) {
+        for (size_t light_id : group_ids.at(command.group_id)) {
+            if (!is_patched[light_id]) continue;
+            auto& segments = patches[light_id];
+
+            if (!segments.empty() && segments.back().start_sample == command.trigger_sample) {
+                segments.back().animation = command.animation;
+            } else {
+                segments.push_back({command.trigger_sample, command.animation});
+            }
+        }
+    }
+
+    for (size_t light_id = 0; light_id < tracks.size(); ++light_id) {
+        if (!is_patched[light_id]) continue;
+        auto& track = tracks[light_id];
+
+        auto first = std::lower_bound(track.begin(), track.end(), TimelineSegment{from, {}}, [](const TimelineSegment& a, const TimelineSegment& b) {
+            return compare(a, b);
+        });
+        auto last = std::upper_bound(first, track.end(), TimelineSegment{to, {}}, [](const TimelineSegment& a, const TimelineSegment& b) {
+            return compare(a, b);
+        });
+
+        auto position = track.erase(first, last);
+        track.insert(position, patches[light_id].begin(), patches[light_id].end());
+    }
+}
+
+void Timeline::clear() {
+    version++;
+    for (auto& track : tracks) track.clear();
+}
+
+size_t Timeline::lightCount() const {
+    return tracks.size();
+}
+
+const std::vector<TimelineSegment> & Timeline::getTrack(size_t light) const {
+    return tracks.at(light);
+}
+
+uint64_t Timeline::getVersion() const {
+    return version;
+}
+
+std::ptrdiff_t Timeline::segmentIndexAt(size_t light, int64_t sample) const {
+    const auto& track = tracks.at(light);
+
+    // First segment starting after the sample, the active one is right before it
+    auto it = std::upper_bound(track.begin(), track.end(), TimelineSegment{sample, {}}, [](const TimelineSegment& a, const TimelineSegment& b) {
+        return compare(a, b);
+    });
+
+    return std::distance(track.begin(), it) - 1;
+}
+
+const AnimationDesc & Timeline::animationAt(size_t light, int64_t sample) const {
+    auto index = segmentIndexAt(light, sample);
+
+    if (index < 0) return default_animation;
+    return tracks[light][index].animation;
+}
+
+Color Timeline::evaluateAt(size_t light, int64_t sample) const {
+    return computeAnimationColor(animationAt(light, sample), sample);
+}
+
+void Timeline::evaluateAt(int64_t sample, std::vector<Color> &light_states) const {
+    light_states.resize(tracks.size());
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        light_states[i] = evaluateAt(i, sample);
+    }
+}
@@ -0,0 +1,57 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "LightManager.h"
+
+
+struct TimelineSegment {
+    int64_t start_sample;
+    AnimationDesc animation;
+};
+
+inline bool compare(const TimelineSegment& a, const TimelineSegment& b) {
+    return a.start_sample < b.start_sample;
+}
+
+// The show compiled into one sorted track of segments per light: the animation of a light at any
+// sample is a binary search away, so seeking backwards doesn't need to replay the commands.
+class Timeline {
+public:
+    // Commands must be ordered by trigger time. Commands sharing a trigger are applied in order.
+    void compile(const std::vector<Command>& commands, const std::vector<std::vector<size_t>>& group_ids, size_t light_count);
+    // Recompile only the segments of `lights` starting in [from, to]. `commands` must hold every enabled
+    // command triggered in that range, ordered by trigger time, the rest of the tracks is left untouched.
+    void patch(int64_t from, int64_t to, const std::vector<size_t>& lights, const std::vector<Command>& commands, const std::vector<std::vector<size_t>>& group_ids);
+    void clear();
+
+    size_t lightCount() const;
+    const std::vector<TimelineSegment>& getTrack(size_t light) const;
+
+    // Bumped by every compile, patch and clear, so cached segment indices can be dropped
+    uint64_t getVersion() const;
+
+    // Index in getTrack(light) of the segment driving the light at `sample`, -1 before the first one. O(log n)
+    std::ptrdiff_t segmentIndexAt(size_t light, int64_t sample) const;
+
+    // Animation driving the light at `sample`, the default one before its first segment. O(log n)
+    const AnimationDesc& animationAt(size_t light, int64_t sample) const;
+
+    Color evaluateAt(size_t light, int64_t sample) const;
+    void evaluateAt(int64_t sample, std::vector<Color>& light_states) const;
+
+private:
+    std::vector<std::vector<TimelineSegment>> tracks;
+    uint64_t version = 0;
+};
+
+
+
+#endif //TIMELINE_H
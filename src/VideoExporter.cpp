@@ -0,0 +1,127 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#include "VideoExporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+VideoExporter::VideoExporter(const std::string &path,
+                             LightManager &light_manager,
+                             Odin::Renderer &renderer,
+                             std::span<const float> samples,
+                             int sample_rate,
+                             const ExportSettings &settings,
+                             int64_t end_sample,
+                             int first_frame,
+                             int end_frame)
+    : light_manager(light_manager),
+      renderer(renderer),
+      sample_rate(sample_rate),
+      settings(settings),
+      first_frame(first_frame) {
+
+    encoder = std::make_unique<MP4Encoder>(path, settings, sample_rate, samples.empty() ? 0 : 1);
+    encoder->setAudio(samples);
+
+    if (end_frame < 0) end_frame = int(end_sample * settings.framerate / sample_rate);
+    frame_count = std::max(0, end_frame - first_frame);
+
+    color_frames.resize(EVALUATION_DEPTH);
+    for (int i = 0; i < EVALUATION_DEPTH; ++i) free_color_frames.push(i);
+    evaluation_thread = std::thread([this]() { evaluationLoop(); });
+}
+
+VideoExporter::~VideoExporter() {
+    try {
+        finish();
+    } catch (const std::exception& e) {
+        std::cout << "Failed to finalize the video: " << e.what() << std::endl;
+    }
+}
+
+bool VideoExporter::exportFrame() {
+    if (isDone()) {
+        finish();
+        return false;
+    }
+
+    auto slot = evaluated_frames.pop();
+    if (!slot) throw std::runtime_error("The light evaluation stopped early");
+
+    renderer.setViewport(settings.width, settings.height);
+    renderer.Render(color_frames[*slot]);
+    free_color_frames.push(*slot);
+
+    encoder->addOpenGLFrame(renderer.GetFboOut());
+
+    current_frame++;
+    return true;
+}
+
+bool VideoExporter::exportFor(double seconds) {
+    using clock = std::chrono::steady_clock;
+    auto deadline = clock::now() + std::chrono::duration<double>(seconds);
+
+    // Always make some progress, even with a budget shorter than a frame
+    do {
+        if (!exportFrame()) return true;
+    } while (clock::now() < deadline);
+
+    if (!isDone()) return false;
+    finish();
+    return true;
+}
+
+void VideoExporter::exportAll() {
+    while (exportFrame()) {}
+}
+
+bool VideoExporter::isDone() const {
+    return current_frame >= frame_count;
+}
+
+int VideoExporter::getCurrentFrame() const {
+    return current_frame;
+}
+
+int VideoExporter::getFrameCount() const {
+    return frame_count;
+}
+
+float VideoExporter::getProgress() const {
+    return frame_count > 0 ? float(current_frame) / float(frame_count) : 1.f;
+}
+
+void VideoExporter::evaluationLoop() {
+    for (int frame = 0; frame < frame_count; ++frame) {
+        auto slot = free_color_frames.pop();
+        if (!slot) return;
+
+        // Any start frame works, the timeline is random access
+        int64_t current_sample = int64_t(int64_t(first_frame + frame) * sample_rate / settings.framerate);
+        light_manager.updateAnimations(current_sample);
+        light_manager.updateLightStates(current_sample);
+
+        // Copy into a pooled buffer, its capacity is reused from one frame to the next
+        color_frames[*slot] = light_manager.getLightColors();
+        if (!evaluated_frames.push(*slot)) return;
+    }
+}
+
+void VideoExporter::stopEvaluation() {
+    free_color_frames.close();
+    evaluated_frames.close();
+    if (evaluation_thread.joinable()) evaluation_thread.join();
+}
+
+void VideoExporter::finish() {
+    stopEvaluation();
+    if (!encoder) return;
+
+    encoder->finalize();
+    encoder.reset();
+}
@@ -0,0 +1,79 @@
+//
+// Created by victor on 18/10/26.
+//
+
+#ifndef VIDEOEXPORTER_H
+#define VIDEOEXPORTER_H
+
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "Encoder.h"
+#include "ExportSettings.h"
+#include "LightManager.h"
+#include "2D renderer/Renderer.h"
+
+// Renders a compiled show frame by frame and feeds the encoder.
+// Not tied to the UI loop: the app drives it with a time budget per UI frame, the headless export runs it to the end.
+// The light states are evaluated ahead on their own thread, the calling thread only renders.
+class VideoExporter {
+public:
+    // The light manager must hold the compiled show and must not be touched by anyone else until the export is done.
+    // The samples must outlive the exporter, no samples means no audio track. A GL context must be current for the
+    // whole export. Only the frames in [first_frame, end_frame) are exported, end_frame = -1 stops at end_sample
+    VideoExporter(const std::string& path,
+                  LightManager& light_manager,
+                  Odin::Renderer& renderer,
+                  std::span<const float> samples,
+                  int sample_rate,
+                  const ExportSettings& settings,
+                  int64_t end_sample,
+                  int first_frame = 0,
+                  int end_frame = -1);
+    ~VideoExporter();
+
+    // Render and encode the next frame. Return false once every frame has been exported
+    bool exportFrame();
+
+    // Export frames until done or `seconds` have elapsed. Return true once done
+    bool exportFor(double seconds);
+
+    void exportAll();
+
+    bool isDone() const;
+    int getCurrentFrame() const;
+    int getFrameCount() const;
+    float getProgress() const;
+
+private:
+    void evaluationLoop();
+    void stopEvaluation();
+    void finish();
+
+    LightManager& light_manager;
+    Odin::Renderer& renderer;
+
+    std::unique_ptr<MP4Encoder> encoder;
+
+    int sample_rate;
+    ExportSettings settings;
+
+    int first_frame = 0;
+    int current_frame = 0;      // Relative to first_frame
+    int frame_count = 0;
+
+    // Pool of evaluated light colors, the evaluation runs at most EVALUATION_DEPTH frames ahead of the renderer
+    static constexpr int EVALUATION_DEPTH = 8;
+    std::vector<std::vector<glm::vec4>> color_frames;
+    BoundedQueue<int> free_color_frames{EVALUATION_DEPTH};
+    BoundedQueue<int> evaluated_frames{EVALUATION_DEPTH};
+    std::thread evaluation_thread;
+};
+
+
+
+#endif //VIDEOEXPORTER_H
@@ -15,22 +15,20 @@ Viewport::Viewport(){
 void Viewport::init(int width, int height) {
 
     renderer.InitRenderer(width, height);
-    for (int i = 0; i < 12; ++i) {
-        m_colors[i] = glm::vec4(0.f, 0.f, 0.f, 0.f);
-    }
+    m_colors.assign(12, glm::vec4(0.f, 0.f, 0.f, 0.f));
     m_width = width;
     m_height = height;
 }
 
 void Viewport::setColors(const std::vector<Color> &colors) {
-    std::array<glm::vec4, 12> c;
-    for (int i = 0; i < 12; ++i) {
+    std::vector<glm::vec4> c(colors.size());
+    for (size_t i = 0; i < colors.size(); ++i) {
         c[i] = glm::vec4(colors[i].r / 255.f, colors[i].g / 255.f, colors[i].b / 255.f, colors[i].a / 255.f);
     }
     setColors(c);
 }
 
-void Viewport::setColors(const std::array<glm::vec4, 12> &colors) {
+void Viewport::setColors(const std::vector<glm::vec4> &colors) {
     m_colors = colors;
 }
 
@@ -28,14 +28,14 @@ public:
 
     // Set RGBA colors for the 12 lights (in row order: 5,2,5).
     void setColors(const std::vector<Color>& colors);
-    void setColors(const std::array<glm::vec4, 12>& colors);
+    void setColors(const std::vector<glm::vec4>& colors);
 
     void draw();
 
     // Resize the offscreen texture (call when ImGui preview window size changes).
     void resize(int width, int height);
 private:
-    std::array<glm::vec4, 12> m_colors;
+    std::vector<glm::vec4> m_colors;
     Odin::Renderer renderer;
 
     int m_width;
@@ -17,9 +17,7 @@ void WaveformViewer::drawMenuBar() {
     ImGui::Spacing();
     ImGui::Checkbox(" Waveform", &show_waveform);
     ImGui::Spacing();
-    ImGui::BeginDisabled(computing_envelope);
     ImGui::Checkbox(" Envelope", &show_envelope);
-    ImGui::EndDisabled();
     ImGui::Spacing();
     ImGui::Separator();
     ImGui::Spacing();
@@ -73,103 +71,94 @@ void WaveformViewer::drawGrid(ImDrawList *draw_list, ImVec2 canvas_pos, ImVec2 c
 void WaveformViewer::drawWaveform(ImDrawList *draw_list, ImVec2 canvas_pos, ImVec2 canvas_size) {
     if (waveform_data.empty()) return;
 
-    float samples_per_pixel = getSamplesPerPixel();
-    std::vector<ImVec2> points;
-
-    for (int x = 0; x < canvas_size.x; ++x) {
-        float sample_pos = horizontal_offset + x * samples_per_pixel;
+    static const ImU32 peak_color = IM_COL32(100, 200, 255, 255);
+    static const ImU32 rms_color = IM_COL32(170, 225, 255, 255);
 
-        if (sample_pos >= waveform_data.size()) break;
-
-        float amplitude = 0.0f;
-        if (samples_per_pixel < 1.0f) {
-            // Interpolate when zoomed in
+    float samples_per_pixel = getSamplesPerPixel();
+    int column_count = getVisibleColumnCount(waveform_data.size(), canvas_size.x);
+    if (column_count <= 0) return;
+
+    if (samples_per_pixel < 1.0f) {
+        // Interpolate when zoomed in, a single polyline is enough
+        line_points.clear();
+        for (int x = 0; x < column_count; ++x) {
+            float sample_pos = horizontal_offset + x * samples_per_pixel;
             int idx = (int)sample_pos;
             float frac = sample_pos - idx;
+
+            float amplitude = waveform_data[idx];
             if (idx + 1 < waveform_data.size()) {
                 amplitude = waveform_data[idx] * (1.0f - frac) + waveform_data[idx + 1] * frac;
-            } else {
-                amplitude = waveform_data[idx];
             }
-        } else {
-            // Average when zoomed out
-            int start_idx = (int)sample_pos;
-            int end_idx = std::min((int)(sample_pos + samples_per_pixel), (int)waveform_data.size());
-            float sum = 0.0f;
-            for (int i = start_idx; i < end_idx; ++i) {
-                sum += waveform_data[i];
-            }
-            amplitude = sum / (end_idx - start_idx);
-        }
 
-        float y = amplitudeToPixel(amplitude, canvas_size.y);
-        points.push_back(ImVec2(canvas_pos.x + x, canvas_pos.y + y));
+            line_points.push_back(ImVec2(canvas_pos.x + x, canvas_pos.y + amplitudeToPixel(amplitude, canvas_size.y)));
+        }
+        draw_list->AddPolyline(line_points.data(), (int)line_points.size(), peak_color, 0, 1.0f);
+        return;
     }
 
-    // Draw waveform
-    for (int i = 1; i < points.size(); ++i) {
-        draw_list->AddLine(points[i-1], points[i], IM_COL32(100, 200, 255, 255), 1.0f);
+    // Zoomed out: one min/max column per pixel, with the rms drawn on top
+    draw_list->PrimReserve(column_count * 12, column_count * 8);
+    for (int x = 0; x < column_count; ++x) {
+        PeakBucket peaks = getColumnPeaks(waveform_data, waveform_pyramid, horizontal_offset + x * samples_per_pixel, samples_per_pixel);
+
+        float y_top = amplitudeToPixel(peaks.max, canvas_size.y);
+        float y_bottom = std::max(amplitudeToPixel(peaks.min, canvas_size.y), y_top + 1.0f);
+        draw_list->PrimRect(ImVec2(canvas_pos.x + x, canvas_pos.y + y_top),
+                            ImVec2(canvas_pos.x + x + 1, canvas_pos.y + y_bottom), peak_color);
+
+        float rms_top = std::max(amplitudeToPixel(peaks.rms, canvas_size.y), y_top);
+        float rms_bottom = std::min(amplitudeToPixel(-peaks.rms, canvas_size.y), y_bottom);
+        draw_list->PrimRect(ImVec2(canvas_pos.x + x, canvas_pos.y + rms_top),
+                            ImVec2(canvas_pos.x + x + 1, canvas_pos.y + std::max(rms_bottom, rms_top)), rms_color);
     }
 }
 
 void WaveformViewer::drawEnvelope(ImDrawList *draw_list, ImVec2 canvas_pos, ImVec2 canvas_size) {
     if (!show_envelope || envelope_data.empty()) return;
 
+    static const ImU32 outline_color = IM_COL32(178, 251, 165, 210);
+    static const ImU32 fill_color = IM_COL32(178, 251, 165, 70);
+
     float samples_per_pixel = getSamplesPerPixel();
-    std::vector<ImVec2> envelope_points_pos, envelope_points_neg;
+    int column_count = getVisibleColumnCount(envelope_data.size(), canvas_size.x);
+    if (column_count <= 0) return;
 
-    for (int x = 0; x < canvas_size.x; ++x) {
-        float sample_pos = horizontal_offset + x * samples_per_pixel;
+    line_points.clear();
+    line_points_neg.clear();
 
-        if (sample_pos >= envelope_data.size()) break;
+    // Fill between envelopes, batched in a single reservation
+    draw_list->PrimReserve(column_count * 6, column_count * 4);
+    for (int x = 0; x < column_count; ++x) {
+        float sample_pos = horizontal_offset + x * samples_per_pixel;
 
         float amplitude = 0.0f;
         if (samples_per_pixel < 1.0f) {
             // Interpolate when zoomed in
             int idx = (int)sample_pos;
             float frac = sample_pos - idx;
+            amplitude = envelope_data[idx];
             if (idx + 1 < envelope_data.size()) {
                 amplitude = envelope_data[idx] * (1.0f - frac) + envelope_data[idx + 1] * frac;
-            } else {
-                amplitude = envelope_data[idx];
             }
         } else {
-            // Average when zoomed out
-            int start_idx = (int)sample_pos;
-            int end_idx = std::min((int)(sample_pos + samples_per_pixel), (int)envelope_data.size());
-            float sum = 0.0f;
-            for (int i = start_idx; i < end_idx; ++i) {
-                sum += envelope_data[i];
-            }
-            amplitude = sum / (end_idx - start_idx);
+            // Keep the peak of the envelope when zoomed out
+            amplitude = getColumnPeaks(envelope_data, envelope_pyramid, sample_pos, samples_per_pixel).max;
         }
 
         float y_pos = amplitudeToPixel(amplitude, canvas_size.y);
         float y_neg = amplitudeToPixel(-amplitude, canvas_size.y);
 
-        envelope_points_pos.push_back(ImVec2(canvas_pos.x + x, canvas_pos.y + y_pos));
-        envelope_points_neg.push_back(ImVec2(canvas_pos.x + x, canvas_pos.y + y_neg));
-    }
-
-    // Draw positive envelope
-    for (int i = 1; i < envelope_points_pos.size(); ++i) {
-        draw_list->AddLine(envelope_points_pos[i-1], envelope_points_pos[i],
-                         IM_COL32(178, 251, 165, 210), 1.5f);
-    }
+        line_points.push_back(ImVec2(canvas_pos.x + x, canvas_pos.y + y_pos));
+        line_points_neg.push_back(ImVec2(canvas_pos.x + x, canvas_pos.y + y_neg));
 
-    // Draw negative envelope
-    for (int i = 1; i < envelope_points_neg.size(); ++i) {
-        draw_list->AddLine(envelope_points_neg[i-1], envelope_points_neg[i],
-                         IM_COL32(178, 251, 165, 210), 1.5f);
+        draw_list->PrimRect(ImVec2(canvas_pos.x + x, canvas_pos.y + y_pos),
+                            ImVec2(canvas_pos.x + x + 1, canvas_pos.y + std::max(y_neg, y_pos)), fill_color);
     }
 
-    // Optional: Fill between envelopes for a more solid look
-    if (envelope_points_pos.size() > 1) {
-        for (int i = 0; i < envelope_points_pos.size(); ++i) {
-            draw_list->AddLine(envelope_points_pos[i], envelope_points_neg[i],
-                             IM_COL32(178, 251, 165, 70), 1.0f);
-        }
-    }
+    // Draw positive and negative envelope
+    draw_list->AddPolyline(line_points.data(), (int)line_points.size(), outline_color, 0, 1.5f);
+    draw_list->AddPolyline(line_points_neg.data(), (int)line_points_neg.size(), outline_color, 0, 1.5f);
 }
 
 void WaveformViewer::drawNotes(ImDrawList *draw_list, ImVec2 canvas_pos, ImVec2 canvas_size) {
@@ -215,68 +204,99 @@ void WaveformViewer::drawCursor(ImDrawList *draw_list, ImVec2 canvas_pos, ImVec2
 }
 
 void WaveformViewer::drawKeyframes(ImDrawList *draw_list, ImVec2 canvas_pos, ImVec2 canvas_size) {
-
-    selected_keyframe_index = -1;
-    for (int i = 0; i < keyframes.size(); ++i) {
-        float keyframe_x = sampleToPixel(keyframes[i].trigger_sample, canvas_size.x);
-
-        // Draw keyframe handle at top (larger, easier to click)
-        static ImVec2 rect_size{5, 10};
-        static float rec_rounding = 5.f;
+    // Draw keyframe handle at top (larger, easier to click)
+    static ImVec2 rect_size{5, 10};
+    static float rec_rounding = 5.f;
+
+    // Ordered by priority, a cluster takes the color of its most important keyframe
+    static const ImU32 state_colors[] = {
+        IM_COL32(120, 120, 120, 255),   // Disabled
+        IM_COL32(255, 100, 120, 255),   // Locked
+        IM_COL32(255, 200, 100, 255),   // Default
+    };
+
+    auto draw_handle = [&](float keyframe_x, ImU32 color, bool is_selected) {
         ImVec2 handle_center = ImVec2(canvas_pos.x + keyframe_x, canvas_pos.y + rect_size.y + 2);
 
-        static ImU32 disabled_color = IM_COL32(120, 120, 120, 255);
-        static ImU32 locked_color   = IM_COL32(255, 100, 120, 255);
-        static ImU32 default_color   = IM_COL32(255, 200, 100, 255);
-
-        if (keyframe_x >= -10 && keyframe_x <= canvas_size.x + 10) {
-
-            ImU32 color = default_color;
-            if (!keyframes[i].is_enabled) color = disabled_color;
-            else if (keyframes[i].is_locked) color = locked_color;
-
-            if (selected_keyframes.contains(keyframes[i].uuid)) {
-                selected_keyframe_index = i;
-
-                static const ImU32 halo_colors[] = {
-                    IM_COL32(100, 150, 255, 60),  // Outer (most transparent)
-                    IM_COL32(100, 150, 255, 100), // Middle
-                    IM_COL32(100, 150, 255, 140)  // Inner (most opaque)
-                };
-                static const float halo_sizes[] = {4.0f, 2.5f, 1.5f};
-
-                // Draw multiple layers for smoother glow
-                for (int layer = 0; layer < 3; ++layer) {
-                    draw_list->AddRectFilled(
-                        ImVec2(handle_center.x - rect_size.x - halo_sizes[layer],
-                               handle_center.y - rect_size.y - halo_sizes[layer]),
-                        ImVec2(handle_center.x + rect_size.x + halo_sizes[layer],
-                               handle_center.y + rect_size.y + halo_sizes[layer]),
-                        halo_colors[layer], rec_rounding + halo_sizes[layer]);
-
-                    draw_list->AddRectFilled(
-                        ImVec2(canvas_pos.x + keyframe_x - halo_sizes[layer],
-                               canvas_pos.y + 15 - halo_sizes[layer]),
-                        ImVec2(canvas_pos.x + keyframe_x + halo_sizes[layer],
-                               canvas_pos.y + canvas_size.y + halo_sizes[layer]),
-                        halo_colors[layer], rec_rounding + halo_sizes[layer]);
-                }
+        if (is_selected) {
+            static const ImU32 halo_colors[] = {
+                IM_COL32(100, 150, 255, 60),  // Outer (most transparent)
+                IM_COL32(100, 150, 255, 100), // Middle
+                IM_COL32(100, 150, 255, 140)  // Inner (most opaque)
+            };
+            static const float halo_sizes[] = {4.0f, 2.5f, 1.5f};
+
+            // Draw multiple layers for smoother glow
+            for (int layer = 0; layer < 3; ++layer) {
+                draw_list->AddRectFilled(
+                    ImVec2(handle_center.x - rect_size.x - halo_sizes[layer],
+                           handle_center.y - rect_size.y - halo_sizes[layer]),
+                    ImVec2(handle_center.x + rect_size.x + halo_sizes[layer],
+                           handle_center.y + rect_size.y + halo_sizes[layer]),
+                    halo_colors[layer], rec_rounding + halo_sizes[layer]);
+
+                draw_list->AddRectFilled(
+                    ImVec2(canvas_pos.x + keyframe_x - halo_sizes[layer],
+                           canvas_pos.y + 15 - halo_sizes[layer]),
+                    ImVec2(canvas_pos.x + keyframe_x + halo_sizes[layer],
+                           canvas_pos.y + canvas_size.y + halo_sizes[layer]),
+                    halo_colors[layer], rec_rounding + halo_sizes[layer]);
             }
+        }
 
-            // Draw keyframe line
-            draw_list->AddLine(ImVec2(canvas_pos.x + keyframe_x, canvas_pos.y + 15),
-                             ImVec2(canvas_pos.x + keyframe_x, canvas_pos.y + canvas_size.y),
-                             color, 1.5f);
+        // Draw keyframe line
+        draw_list->AddLine(ImVec2(canvas_pos.x + keyframe_x, canvas_pos.y + 15),
+                         ImVec2(canvas_pos.x + keyframe_x, canvas_pos.y + canvas_size.y),
+                         color, 1.5f);
+
+        draw_list->AddRectFilled(ImVec2(handle_center.x - rect_size.x, handle_center.y - rect_size.y),
+                               ImVec2(handle_center.x + rect_size.x, handle_center.y + rect_size.y),
+                               color, rec_rounding);
+
+        draw_list->AddRect(ImVec2(handle_center.x - rect_size.x, handle_center.y - rect_size.y),
+                         ImVec2(handle_center.x + rect_size.x, handle_center.y + rect_size.y),
+                         IM_COL32(0, 0, 0, 150), rec_rounding, 0, 1.0f);
+    };
+
+    selected_keyframe_uuid = -1;
+
+    // Binary search the visible window, the handles may stick out of the canvas by a few pixels
+    auto first = keyframes->lower_bound(int64_t(std::floor(pixelToSample(-10, canvas_size.x))));
+    auto last = keyframes->upper_bound(int64_t(std::ceil(pixelToSample(canvas_size.x + 10, canvas_size.x))));
+
+    // Keyframes falling in the same pixel column are drawn once, so zooming out keeps the draw list
+    // bounded by the canvas width whatever the keyframe count
+    float cluster_column = 0;
+    float cluster_x = 0;
+    int cluster_state = -1;
+    bool is_cluster_selected = false;
+
+    for (auto it = first; it != last; ++it) {
+        auto& keyframe = it->second;
+        float keyframe_x = sampleToPixel(keyframe.trigger_sample, canvas_size.x);
+        float column = std::floor(keyframe_x);
+
+        if (cluster_state >= 0 && column != cluster_column) {
+            draw_handle(cluster_x, state_colors[cluster_state], is_cluster_selected);
+            cluster_state = -1;
+            is_cluster_selected = false;
+        }
+
+        if (cluster_state < 0) {
+            cluster_column = column;
+            cluster_x = keyframe_x;
+        }
 
-            draw_list->AddRectFilled(ImVec2(handle_center.x - rect_size.x, handle_center.y - rect_size.y),
-                                   ImVec2(handle_center.x + rect_size.x, handle_center.y + rect_size.y),
-                                   color, rec_rounding);
+        int state = !keyframe.is_enabled ? 0 : keyframe.is_locked ? 1 : 2;
+        cluster_state = std::max(cluster_state, state);
 
-            draw_list->AddRect(ImVec2(handle_center.x - rect_size.x, handle_center.y - rect_size.y),
-                             ImVec2(handle_center.x + rect_size.x, handle_center.y + rect_size.y),
-                             IM_COL32(0, 0, 0, 150), rec_rounding, 0, 1.0f);
+        if (selected_keyframes.contains(keyframe.uuid)) {
+            selected_keyframe_uuid = keyframe.uuid;
+            is_cluster_selected = true;
         }
     }
+
+    if (cluster_state >= 0) draw_handle(cluster_x, state_colors[cluster_state], is_cluster_selected);
 }
 
 void WaveformViewer::drawGradientPreview(ImDrawList* draw_list, ImVec2 canvas_pos, ImVec2 canvas_size)
@@ -315,13 +335,15 @@ void WaveformViewer::drawGradientPreview(ImDrawList* draw_list, ImVec2 canvas_po
 
 void WaveformViewer::drawSelectedKeyFrameTimestamp(ImDrawList* draw_list, ImVec2 canvas_pos, ImVec2 canvas_size)
 {
-    if (selected_keyframes.size() == 1 && selected_keyframe_index >= 0) {
+    if (selected_keyframes.size() == 1 && keyframes->contains(selected_keyframe_uuid)) {
+        auto& keyframe = keyframes->at(selected_keyframe_uuid);
+
         // Get the on-screen position
-        float keyframe_x = sampleToPixel(keyframes[selected_keyframe_index].trigger_sample, canvas_size.x);
+        float keyframe_x = sampleToPixel(keyframe.trigger_sample, canvas_size.x);
 
         float timestamp_x = keyframe_x + 10;
 
-        int timestamp_ms = keyframes[selected_keyframe_index].trigger_sample * 1000 / sample_rate;
+        int timestamp_ms = keyframe.trigger_sample * 1000 / sample_rate;
 
         char buff[128];
         sprintf(buff, "%i ms", timestamp_ms);
@@ -422,7 +444,7 @@ void WaveformViewer::drawDebugWindow() {
         ImGui::Text("Zoom: H=%.2f, V=%.2f", horizontal_zoom, vertical_zoom);
         ImGui::Text("Offset: %.2f samples", horizontal_offset);
         ImGui::Text("Cursor: %.4f samples (%.4fs)", cursor_position, cursor_position / 44100.0f);
-        ImGui::Text("Keyframes: %d", (int)keyframes.size());
+        ImGui::Text("Keyframes: %d", (int)keyframes->size());
         ImGui::Separator();
         ImGui::Text("Controls:");
         ImGui::BulletText("Ctrl+Scroll: Vertical Zoom");
@@ -447,12 +469,13 @@ void WaveformViewer::drawDebugWindow() {
         ImGui::BeginDisabled(computing_notes.load());
         ImGui::Checkbox("Show Notes", &show_notes);
         ImGui::SameLine();
+        // Notes are detected over the whole song, wait for the decode to finish
+        ImGui::BeginDisabled(!sample_store || !sample_store->isComplete());
         if (ImGui::Button("Compute notes")) detect_notes();
         ImGui::EndDisabled();
+        ImGui::EndDisabled();
 
-        ImGui::BeginDisabled(computing_envelope.load());
         ImGui::Checkbox("Show Envelope", &show_envelope);
-        ImGui::EndDisabled();
 
         ImGui::SliderFloat("Envelope Window (ms)", &envelope_window_ms, 1.0f, 100.0f, "%.1f ms");
 
@@ -511,67 +534,62 @@ void WaveformViewer::handleInput(ImVec2 canvas_pos, ImVec2 canvas_size) {
 
                 // Check if clicking on keyframe handle
                 float mouse_y = mouse_pos.y - canvas_pos.y;
-                bool clicked = false;
-                for (int i = 0; i < keyframes.size(); ++i) {
-                    float keyframe_x = sampleToPixel(keyframes[i].trigger_sample, canvas_size.x);
-                    // Check if clicking on the handle (top 20 pixels)
-                    if (abs(mouse_x - keyframe_x) < 8.0f && mouse_y < 20.0f) {
-
-                        if (ImGui::IsKeyDown(ImGuiMod_Ctrl)) {
-                            if (!selected_keyframes.contains(keyframes[i].uuid)) {
-                                keyframe_selection_callback(keyframes[i].uuid);
-                                selected_keyframes.insert(keyframes[i].uuid);
-                            } else {
-                                keyframe_unselection_callback(keyframes[i].uuid);
-                                selected_keyframes.erase(keyframes[i].uuid);
-                            }
-                        } else if (ImGui::IsKeyDown(ImGuiMod_Shift)) {
-
-                            if (selected_keyframes.size() != 1) {
-                                reset_selection_callback();
-                                selected_keyframes.clear();
-
-                                keyframe_selection_callback(keyframes[i].uuid);
-                                selected_keyframes.insert(keyframes[i].uuid);
-                            } else {
-                                keyframe_selection_callback(keyframes[i].uuid);
-                                selected_keyframes.insert(keyframes[i].uuid);
-
-                                auto a = keyframes[selected_keyframe_index].trigger_sample;
-                                auto b = keyframes[i].trigger_sample;
-
-                                auto start = std::min(a, b);
-                                auto end = std::max(a, b);
-
-                                for (auto & keyframe: keyframes) {
-                                    if (start < keyframe.trigger_sample && keyframe.trigger_sample < end) {
-                                        keyframe_selection_callback(keyframe.uuid);
-                                        selected_keyframes.insert(keyframe.uuid);
-                                    }
-                                }
-                            }
+                auto hit = hitTestKeyframe(mouse_x, mouse_y, canvas_size.x);
+                if (hit) {
+                    auto& clicked_keyframe = *hit;
+
+                    if (ImGui::IsKeyDown(ImGuiMod_Ctrl)) {
+                        if (!selected_keyframes.contains(clicked_keyframe.uuid)) {
+                            keyframe_selection_callback(clicked_keyframe.uuid);
+                            selected_keyframes.insert(clicked_keyframe.uuid);
+                        } else {
+                            keyframe_unselection_callback(clicked_keyframe.uuid);
+                            selected_keyframes.erase(clicked_keyframe.uuid);
+                        }
+                    } else if (ImGui::IsKeyDown(ImGuiMod_Shift)) {
 
+                        if (selected_keyframes.size() != 1) {
+                            reset_selection_callback();
+                            selected_keyframes.clear();
+
+                            keyframe_selection_callback(clicked_keyframe.uuid);
+                            selected_keyframes.insert(clicked_keyframe.uuid);
                         } else {
-                            if (!selected_keyframes.contains(keyframes[i].uuid)) {
-                                reset_selection_callback();
-                                selected_keyframes.clear();
+                            auto anchor_uuid = *selected_keyframes.begin();
+
+                            keyframe_selection_callback(clicked_keyframe.uuid);
+                            selected_keyframes.insert(clicked_keyframe.uuid);
 
-                                keyframe_selection_callback(keyframes[i].uuid);
-                                selected_keyframes.insert(keyframes[i].uuid);
+                            auto a = keyframes->at(anchor_uuid).trigger_sample;
+                            auto b = clicked_keyframe.trigger_sample;
+
+                            auto start = std::min(a, b);
+                            auto end = std::max(a, b);
+
+                            // Only walk the keyframes between the two ends
+                            for (auto it = keyframes->upper_bound(start); it != keyframes->end() && it->second.trigger_sample < end; ++it) {
+                                keyframe_selection_callback(it->second.uuid);
+                                selected_keyframes.insert(it->second.uuid);
                             }
                         }
 
-                        dragging_keyframe = true;
-                        clicked = true;
-                        break;
+                    } else {
+                        if (!selected_keyframes.contains(clicked_keyframe.uuid)) {
+                            reset_selection_callback();
+                            selected_keyframes.clear();
+
+                            keyframe_selection_callback(clicked_keyframe.uuid);
+                            selected_keyframes.insert(clicked_keyframe.uuid);
+                        }
                     }
+
+                    dragging_keyframe = true;
                 }
 
-                if (!clicked) {
+                if (!hit) {
                     // Move cursor
                     reset_selection_callback();
-                    cursor_position = pixelToSample(mouse_x, canvas_size.x);
-                    cursor_position = std::clamp(cursor_position, 0.0f, (float)waveform_data.size());
+                    scrubCursorTo(mouse_x, canvas_size.x);
                     dragging_cursor = true;
                 }
             }
@@ -582,8 +600,7 @@ void WaveformViewer::handleInput(ImVec2 canvas_pos, ImVec2 canvas_size) {
                     keyframe_drag_callback(pixelToSample(delta, canvas_size.x) - horizontal_offset);
 
                 } else if (dragging_cursor) {
-                    cursor_position = pixelToSample(mouse_x, canvas_size.x);
-                    cursor_position = std::clamp(cursor_position, 0.0f, (float)waveform_data.size());
+                    scrubCursorTo(mouse_x, canvas_size.x);
                 }
             }
 
@@ -599,13 +616,8 @@ void WaveformViewer::handleInput(ImVec2 canvas_pos, ImVec2 canvas_size) {
         // Handle Enter key for adding keyframes
         if (ImGui::IsWindowFocused() && ImGui::IsKeyPressed(ImGuiKey_Enter)) {
             // Check if keyframe already exists at cursor position
-            bool exists = false;
-            for (auto& kf : keyframes) {
-                if (abs(kf.trigger_sample - cursor_position) < getSamplesPerPixel()) {
-                    exists = true;
-                    break;
-                }
-            }
+            auto nearest = keyframes->upper_bound(int64_t(cursor_position - getSamplesPerPixel()));
+            bool exists = nearest != keyframes->end() && abs(nearest->second.trigger_sample - cursor_position) < getSamplesPerPixel();
 
             if (!exists) {
                 keyframe_creation_callback(cursor_position);
@@ -634,6 +646,25 @@ float WaveformViewer::amplitudeToPixel(float amplitude, float canvas_height) con
     return canvas_height * 0.5f - amplitude * vertical_zoom * canvas_height * 0.4f;
 }
 
+int WaveformViewer::getVisibleColumnCount(std::size_t sample_count, float canvas_width) const {
+    if (horizontal_offset >= sample_count) return 0;
+    float columns = std::ceil((sample_count - horizontal_offset) / getSamplesPerPixel());
+    return (int)std::min(columns, std::ceil(canvas_width));
+}
+
+PeakBucket WaveformViewer::getColumnPeaks(std::span<const float> data, const PeakPyramid &pyramid, float start_sample, float samples_per_pixel) const {
+    std::size_t start = std::min((std::size_t)start_sample, data.size() - 1);
+    std::size_t end = std::clamp((std::size_t)(start_sample + samples_per_pixel), start + 1, data.size());
+
+    int level = pyramid.pickLevel(samples_per_pixel);
+    if (level < 0 || pyramid.sampleCount() != data.size()) {
+        // Less than one bucket per pixel, reading the samples is cheap enough
+        return computePeakBucket(data.data() + start, end - start);
+    }
+
+    return pyramid.query(level, start, end);
+}
+
 void WaveformViewer::update_offset(float canvas_width) {
     if (is_auto_scroll_enabled) {
         if (cursor_position > horizontal_offset + canvas_width / 4 / horizontal_zoom) {
@@ -642,11 +673,29 @@ void WaveformViewer::update_offset(float canvas_width) {
     }
 }
 
+void WaveformViewer::refreshSamples() {
+    if (!sample_store) return;
+
+    // Completion first: if it is set, the prefix loaded after it is the whole song
+    const bool is_complete = sample_store->isComplete();
+    waveform_data = sample_store->samples();
+    waveform_pyramid.extend(waveform_data);
+
+    // Bounded per frame, so a window change or a long song never stalls the UI
+    const std::size_t envelope_size = envelope_data.size();
+    extend_envelope(waveform_data, is_complete, int(sample_rate), envelope_window_ms, envelope_data, envelope_samples_per_frame);
+    if (envelope_data.size() != envelope_size) envelope_pyramid.extend(envelope_data);
+}
+
 void WaveformViewer::detect_notes() {
+    // A partially decoded song would silently give a partial note list
+    if (!sample_store || !sample_store->isComplete()) return;
+
     if (!computing_notes.load()) {
         computing_notes.store(true);
-        std::thread detection_thread([this]() {
-            notes = detectNotes(waveform_data, sample_rate);
+        // The store is kept alive by the thread, a new song may be loaded meanwhile
+        std::thread detection_thread([this, store = sample_store, samples = sample_store->samples()]() {
+            notes = detectNotes(samples, sample_rate);
             computing_notes.store(false);
         });
         detection_thread.detach();
@@ -654,14 +703,34 @@ void WaveformViewer::detect_notes() {
 }
 
 void WaveformViewer::computeEnvelope() {
-    if (!computing_envelope.load()) {
-        computing_envelope.store(true);
-        std::thread envelope_thread([this]() {
-            envelope_data = compute_envelope(waveform_data, sample_rate, envelope_window_ms);
-            computing_envelope.store(false);
-        });
-        envelope_thread.detach();
-    }
+    // Rebuilt from the start over the next frames, with the current window
+    envelope_data.clear();
+    envelope_pyramid.clear();
+}
+
+const Keyframe * WaveformViewer::hitTestKeyframe(float mouse_x, float mouse_y, float canvas_width) const {
+    static constexpr float hit_radius = 8.0f;
+
+    // Only the handles are clickable (top 20 pixels)
+    if (mouse_y >= 20.0f) return nullptr;
+
+    // The nearest keyframe is either the first one at or after the mouse, or the one just before it
+    auto next = keyframes->lower_bound(int64_t(std::floor(pixelToSample(mouse_x, canvas_width))));
+
+    const Keyframe* nearest = nullptr;
+    float nearest_distance = hit_radius;
+    auto consider = [&](const Keyframe& keyframe) {
+        float distance = std::abs(mouse_x - sampleToPixel(keyframe.trigger_sample, canvas_width));
+        if (distance < nearest_distance) {
+            nearest = &keyframe;
+            nearest_distance = distance;
+        }
+    };
+
+    if (next != keyframes->begin()) consider(std::prev(next)->second);
+    if (next != keyframes->end()) consider(next->second);
+
+    return nearest;
 }
 
 int WaveformViewer::get_first_note_at_sample(int sample) const {
@@ -686,7 +755,11 @@ int WaveformViewer::get_first_note_at_sample(int sample) const {
     return -1;
 }
 
-WaveformViewer::WaveformViewer() {
+namespace {
+    const KeyframeStore no_keyframes;
+}
+
+WaveformViewer::WaveformViewer() : keyframes(&no_keyframes) {
 
 }
 
@@ -710,6 +783,8 @@ void WaveformViewer::draw() {
 
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
 
+    refreshSamples();
+
     // Handle input
     handleInput(canvas_pos, canvas_size);
     update_offset(canvas_size.x);
@@ -756,6 +831,14 @@ void WaveformViewer::draw() {
     ImGui::End();
 }
 
+void WaveformViewer::scrubCursorTo(float mouse_x, float canvas_width) {
+    float new_position = std::clamp(pixelToSample(mouse_x, canvas_width), 0.0f, (float)waveform_data.size());
+    if (new_position == cursor_position) return;
+
+    cursor_position = new_position;
+    if (cursor_scrub_callback) cursor_scrub_callback(int64_t(cursor_position));
+}
+
 void WaveformViewer::set_cursor_position(float cursor_position) {
     this->cursor_position = cursor_position;
 }
@@ -768,13 +851,16 @@ void WaveformViewer::set_sample_rate(float sample_rate) {
     this->sample_rate = sample_rate;
 }
 
-void WaveformViewer::set_waveform_data(const std::vector<float>& waveform_data) {
-    this->waveform_data = waveform_data;
+void WaveformViewer::set_sample_store(std::shared_ptr<const SampleStore> sample_store) {
+    this->sample_store = std::move(sample_store);
+    waveform_data = {};
+    waveform_pyramid.clear();
     computeEnvelope();
+    refreshSamples();
 }
 
-void WaveformViewer::set_keyframes(const std::vector<Keyframe>& keyframes) {
-    this->keyframes = keyframes;
+void WaveformViewer::set_keyframes(const KeyframeStore* keyframes) {
+    this->keyframes = keyframes ? keyframes : &no_keyframes;
 }
 
 void WaveformViewer::set_selected_keyframe(const std::set<int64_t> &selected_keyframes_uuid) {
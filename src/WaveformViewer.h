@@ -7,12 +7,17 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <set>
+#include <span>
 #include <vector>
 
 #include "imgui.h"
 #include "AudioUtils.h"
+#include "KeyframeStore.h"
 #include "LightManager.h"
+#include "PeakPyramid.h"
+#include "SampleStore.h"
 
 
 
@@ -26,17 +31,23 @@ public:
     std::function<void(int64_t)> keyframe_unselection_callback = nullptr;
     std::function<void()> reset_selection_callback = nullptr;
 
+    // Called every time the user moves the cursor by clicking or dragging, with the new cursor sample
+    std::function<void(int64_t)> cursor_scrub_callback = nullptr;
+
 private:
-    std::vector<float> waveform_data;
+    // Shared with the audio manager, may still be decoding. waveform_data is its prefix as of this frame
+    std::shared_ptr<const SampleStore> sample_store;
+    std::span<const float> waveform_data;
+    PeakPyramid waveform_pyramid;
     float sample_rate = 44100.0f;
     float horizontal_zoom = 1.0f;
     float vertical_zoom = 1.0f;
     float horizontal_offset = 0.0f; // Sample
     float cursor_position = 0.0f; // Sample
 
-    std::vector<Keyframe> keyframes;
+    const KeyframeStore* keyframes; // Owned by the app, never copied
     std::set<int64_t> selected_keyframes;
-    int selected_keyframe_index = -1;
+    int64_t selected_keyframe_uuid = -1;
     bool dragging_cursor = false;
     bool dragging_keyframe = false;
 
@@ -60,10 +71,11 @@ private:
     std::atomic_bool computing_notes = false;
     float note_window_ms = 10.0f;
 
-    // Envelope
+    // Envelope, extended every frame as the samples arrive
+    static constexpr std::size_t envelope_samples_per_frame = 1 << 20;
     std::vector<float> envelope_data;
+    PeakPyramid envelope_pyramid;
     bool show_envelope = false;
-    std::atomic_bool computing_envelope = false;
     float envelope_window_ms = 10.0f;
 
     // Gradient preview
@@ -71,6 +83,10 @@ private:
     int64_t gradient_duration; // In sample
     bool draw_gradient_preview;
 
+    // Scratch buffers reused by the line drawing, to avoid allocating every frame
+    std::vector<ImVec2> line_points;
+    std::vector<ImVec2> line_points_neg;
+
 
 
 
@@ -96,12 +112,21 @@ private:
     float pixelToSample(float pixel, float canvas_width) const;
     float amplitudeToPixel(float amplitude, float canvas_height) const;
 
+    int getVisibleColumnCount(std::size_t sample_count, float canvas_width) const;
+    PeakBucket getColumnPeaks(std::span<const float> data, const PeakPyramid& pyramid, float start_sample, float samples_per_pixel) const;
+
     void update_offset(float canvas_width);
+    void scrubCursorTo(float mouse_x, float canvas_width);
+
+    // Pick up the samples decoded since the last frame and extend the pyramids and the envelope
+    void refreshSamples();
 
     void detect_notes();
     void computeEnvelope();
 
     int get_first_note_at_sample(int sample) const;
+    // Keyframe whose handle is under the mouse, nullptr if none. O(log n)
+    const Keyframe* hitTestKeyframe(float mouse_x, float mouse_y, float canvas_width) const;
 
 public:
     WaveformViewer();
@@ -111,9 +136,9 @@ public:
     float get_cursor_position();
 
     void set_sample_rate(float sample_rate);
-    void set_waveform_data(const std::vector<float>& waveform_data);
+    void set_sample_store(std::shared_ptr<const SampleStore> sample_store);
 
-    void set_keyframes(const std::vector<Keyframe>& keyframes);
+    void set_keyframes(const KeyframeStore* keyframes);
     void set_selected_keyframe(const std::set<int64_t>& selected_keyframes_uuid);
 
     void set_gradient_preview(int64_t start, int64_t duration);
@@ -1,4 +1,5 @@
 #include "EliseApp.h"
+#include "HeadlessExport.h"
 
 
 
@@ -7,7 +8,15 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../libs/stb_image.h"
-int main() {
+int main(int argc, char** argv) {
+
+    HeadlessExportOptions export_options;
+    try {
+        if (parseHeadlessExportArgs(argc, argv, export_options)) return runHeadlessExport(export_options);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
 
     EliseApp app;
     if (app.init()) {